@@ -0,0 +1,90 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace dsp
+{
+    // a view of memory an Arena handed out, indexed like the vector it replaces
+    template<typename T>
+    struct Span
+    {
+        Span() noexcept : ptr(nullptr), count(0) {}
+        Span(T* _ptr, size_t _count) noexcept : ptr(_ptr), count(_count) {}
+
+        T* data() const noexcept { return ptr; }
+        size_t size() const noexcept { return count; }
+        bool empty() const noexcept { return count == 0; }
+        T* begin() const noexcept { return ptr; }
+        T* end() const noexcept { return ptr + count; }
+        T& operator[](size_t i) const noexcept { return ptr[i]; }
+
+    protected:
+        T* ptr;
+        size_t count;
+    };
+
+    // the audio thread's working memory. everything prepareToPlay sets up
+    // takes its buffers from here, in order, and nothing after it does. the
+    // first prepare may need more than one block, reset() merges them into
+    // one as large as everything taken, so running the same prepare again
+    // ends up with a single allocation. that one gets reused as long as the
+    // settings don't outgrow it
+    struct Arena
+    {
+        static constexpr size_t Alignment = 64, MinBlockSize = 1 << 16;
+
+        Arena() :
+            blocks(),
+            numBytes(0)
+        {}
+
+        // forgets everything taken. the memory stays
+        void reset()
+        {
+            if (blocks.size() > 1) {
+                blocks.clear();
+                blocks.push_back(Block(numBytes));
+            }
+            for (auto& block : blocks)
+                block.used = 0;
+            numBytes = 0;
+        }
+
+        // n zeroed values, aligned for any simd register
+        template<typename T>
+        Span<T> take(size_t n)
+        {
+            static_assert(std::is_trivially_copyable_v<T>, "the arena doesn't run constructors");
+            const auto bytes = (n * sizeof(T) + Alignment - 1) & ~(Alignment - 1);
+            if (blocks.empty() || blocks.back().used + bytes > blocks.back().size)
+                blocks.push_back(Block(std::max(bytes, MinBlockSize)));
+            auto& block = blocks.back();
+            const auto ptr = block.data + block.used;
+            block.used += bytes;
+            numBytes += bytes;
+            std::memset(ptr, 0, bytes);
+            return { reinterpret_cast<T*>(ptr), n };
+        }
+
+        // what's been taken since the last reset, with alignment
+        size_t getNumBytes() const noexcept { return numBytes; }
+        int getNumBlocks() const noexcept { return static_cast<int>(blocks.size()); }
+
+    protected:
+        struct Block
+        {
+            Block(size_t _size) :
+                memory(new char[_size + Alignment]),
+                data(memory.get() + (Alignment - reinterpret_cast<uintptr_t>(memory.get()) % Alignment) % Alignment),
+                size(_size),
+                used(0)
+            {}
+
+            std::unique_ptr<char[]> memory;
+            char* data;
+            size_t size, used;
+        };
+
+        std::vector<Block> blocks;
+        size_t numBytes;
+    };
+}
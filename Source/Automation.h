@@ -0,0 +1,89 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LiterallyEverything.h"
+
+namespace dsp
+{
+    // parameter changes at sample offsets into the next block. whoever
+    // drives processBlock adds them right before it, on the same thread,
+    // the way a host with sample accurate automation would. processBlock
+    // splits the block at every event. fixed capacity, so adding never
+    // allocates
+    struct Automation
+    {
+        static constexpr int Capacity = 256;
+
+        struct Event
+        {
+            int offset;
+            param::ID id;
+            float value;
+        };
+
+        Automation() :
+            events(),
+            held(),
+            numEvents(0)
+        {}
+
+        // the parameters the engine takes per sample, the others change latency
+        static bool isSampleAccurate(param::ID id) noexcept
+        {
+            return id == param::ID::Squash || id == param::ID::Gain || id == param::ID::Link;
+        }
+
+        // value in the parameter's own unit. false if the queue is full or
+        // the parameter can't change mid block. events at the same offset
+        // apply in the order they were added
+        bool add(param::ID id, float value, int offset) noexcept
+        {
+            if (numEvents == Capacity || !isSampleAccurate(id))
+                return false;
+            offset = std::max(0, offset);
+            auto i = numEvents++;
+            for (; i > 0 && events[i - 1].offset > offset; --i)
+                events[i] = events[i - 1];
+            events[i] = { offset, id, value };
+            return true;
+        }
+
+        int size() const noexcept { return numEvents; }
+        const Event& operator[](int i) const noexcept { return events[i]; }
+        void clear() noexcept { numEvents = 0; }
+
+        // drops the queue and every held value, e.g. in prepareToPlay
+        void reset() noexcept
+        {
+            clear();
+            for (auto& h : held)
+                h.active = false;
+        }
+
+        // an event's value outlives its block: it holds until the parameter
+        // itself moves away from what it was when the event came
+        void hold(const Event& e, float paramValue) noexcept
+        {
+            held[static_cast<int>(e.id)] = { e.value, paramValue, true };
+        }
+
+        float get(param::ID id, float paramValue) noexcept
+        {
+            auto& h = held[static_cast<int>(id)];
+            if (h.active && h.paramValue == paramValue)
+                return h.value;
+            h.active = false;
+            return paramValue;
+        }
+
+    protected:
+        struct Held
+        {
+            float value, paramValue;
+            bool active;
+        };
+
+        std::array<Event, Capacity> events;
+        std::array<Held, param::NumIDs> held;
+        int numEvents;
+    };
+}
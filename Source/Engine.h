@@ -0,0 +1,511 @@
+#pragma once
+#include "Squash.h"
+#include "Smooth.h"
+#include "Oversampling.h"
+
+namespace dsp
+{
+    // everything processBlock runs, for one sample type. the processor owns
+    // one per precision, so double precision hosts get processed in double
+    // without converting the buffer.
+    template<typename T>
+    struct Engine
+    {
+        using Filter = typename Oversampling<T>::Filter;
+        // larger host blocks get processed in chunks, which bounds the
+        // memory for the oversampled buffers
+        static constexpr int MaxChunkSize = 512;
+        // linear phase at 16x plus second order adaa stays below this
+        static constexpr int MaxLatency = 128;
+        // the dry signal's delay line, for bypassing in line with the latency
+        static constexpr int DrySize = 1024, DryMask = DrySize - 1;
+        static_assert(DrySize >= MaxLatency + MaxChunkSize, "the dry delay line is too short");
+        // how long the filters ring after the latency, before silent input
+        // counts as silent output
+        static constexpr double RingOutMs = 50.;
+        static constexpr double BypassFadeMs = 20.;
+        // how long the hysteresis holds a sign within the threshold
+        static constexpr double ReleaseMs = 50.;
+
+        Engine() :
+            kernels(getKernels<T>()),
+            squashSmooth(), gainSmooth(),
+            oversampler(),
+            target(), link(), adaaState(), linkState(),
+            curve(Curve::Hard), drive(T(1)),
+            holdKernels(&getKernels<T>(ISA::Scalar)), held(), holdState(),
+            threshold(T(0)), holdMs(0.), holdSamples(T(1)), releaseSamples(T(1)),
+            bands(), bandState(),
+            crossoverHz(), bandSquash(), bandGain(),
+            crossoverRate(0.), numBands(1),
+            chunk(), dry(),
+            sampleRate(44100.),
+            numChannels(0), maxBlockSize(0), adaaOrder(0),
+            dryPos(0), dryDelay(0),
+            silentSamples(0), tailSamples(0),
+            fade(T(0)), fadeStep(T(1)),
+            stateInvalid(true), wasLinked(false), wasHolding(false), idle(false), bandsPrimed(false)
+        {}
+
+        // every buffer comes from the arena, none get allocated after this
+        void prepare(Arena& arena, double _sampleRate, int samplesPerBlock, int _numChannels, T squashV, T gainDb)
+        {
+            sampleRate = _sampleRate;
+            numChannels = _numChannels;
+            maxBlockSize = std::min(samplesPerBlock, MaxChunkSize);
+            const auto maxBlockSizeOversampled = maxBlockSize << Oversampling<T>::MaxOrder;
+
+            squashSmooth.prepare(arena, maxBlockSizeOversampled);
+            gainSmooth.prepare(arena, maxBlockSizeOversampled);
+            squashSmooth.reset(squashV);
+            gainSmooth.reset(gainDb);
+            oversampler.prepare(arena, numChannels, maxBlockSize);
+            target = arena.take<T>(static_cast<size_t>(maxBlockSizeOversampled));
+            link = arena.take<T>(static_cast<size_t>(maxBlockSizeOversampled));
+            adaaState = arena.take<T>(static_cast<size_t>(2 * numChannels));
+            linkState = arena.take<T>(2);
+            chunk = arena.take<T*>(static_cast<size_t>(numChannels));
+            dry = arena.take<T>(static_cast<size_t>(numChannels * DrySize));
+            bandState = arena.take<T>(static_cast<size_t>(numChannels * Bands<T>::StateSize));
+
+            // the narrowest isa that fits all channels into one group, like the oversampler
+            for (auto i = 0; i <= static_cast<int>(getISA()); ++i) {
+                holdKernels = &getKernels<T>(static_cast<ISA>(i));
+                if (holdKernels->lanes >= numChannels)
+                    break;
+            }
+            const auto holdLanes = (numChannels + holdKernels->lanes - 1) / holdKernels->lanes * holdKernels->lanes;
+            held = arena.take<T>(static_cast<size_t>(holdLanes * maxBlockSizeOversampled));
+            holdState = arena.take<T>(static_cast<size_t>(3 * (holdLanes + 1)));
+            wasHolding = false;
+            bandsPrimed = false;
+            crossoverRate = 0.;
+            dryPos = 0;
+            silentSamples = 0;
+            idle = false;
+            fadeStep = static_cast<T>(1. / std::max(1., sampleRate * BypassFadeMs * .001));
+
+            adaaOrder = -1;
+        }
+
+        bool isPrepared() const noexcept { return maxBlockSize != 0; }
+
+        // the arena's memory went to something else, process() does nothing until the next prepare
+        void release() noexcept { maxBlockSize = 0; }
+
+        // doesn't allocate. true if anything changed
+        bool setQuality(int _adaaOrder, int osOrder, Filter osFilter) noexcept
+        {
+            if (_adaaOrder == adaaOrder && osOrder == oversampler.getOrder() && osFilter == oversampler.getFilter())
+                return false;
+            oversampler.setOrder(osOrder, osFilter);
+            adaaOrder = _adaaOrder;
+            stateInvalid = true;
+
+            static constexpr double SmoothLengthMs = 20.;
+            const auto sampleRateOversampled = sampleRate * oversampler.getFactor();
+            squashSmooth.setLength(sampleRateOversampled, SmoothLengthMs);
+            gainSmooth.setLength(sampleRateOversampled, SmoothLengthMs);
+
+            const auto latency = getLatency();
+            jassert(latency < MaxLatency);
+            dryDelay = getLatencySamples();
+            tailSamples = 2 * static_cast<int>(std::ceil(latency)) + static_cast<int>(sampleRate * RingOutMs * .001);
+            setHysteresis(threshold, holdMs);
+            return true;
+        }
+
+        // thresholdGain: how far past 0 the input has to go for the hard
+        // curve's sign to turn, 0 is off. holdMs: how long it stays at least.
+        // with either, the sign falls to 0 once the input has been within
+        // the threshold for ReleaseMs, so noise after the signal doesn't end
+        // up as a full scale dc offset. applies to the hard curve without
+        // adaa and bands
+        void setHysteresis(T thresholdGain, double _holdMs) noexcept
+        {
+            threshold = thresholdGain;
+            holdMs = _holdMs;
+            const auto sampleRateOversampled = sampleRate * oversampler.getFactor();
+            holdSamples = static_cast<T>(std::max(1., std::round(sampleRateOversampled * holdMs * .001)));
+            releaseSamples = static_cast<T>(std::max(1., std::round(sampleRateOversampled * ReleaseMs * .001)));
+        }
+
+        // knee in (0, 1], the input level where the soft curves turn. adaa
+        // antialiases Hard, whatever this is
+        void setCurve(Curve c, T knee) noexcept
+        {
+            curve = c;
+            drive = T(1) / knee;
+        }
+
+        // 1 band is off. 2 to 4 split at the first numBands - 1 crossovers,
+        // in hz. every band has its squash in [0, 1] and gain in decibels on
+        // top of the whole signal's. the bands ignore link and adaa
+        void setBands(int _numBands, const T* _crossoverHz, const T* _bandSquash, const T* _bandGainDb) noexcept
+        {
+            _numBands = juce::jlimit(1, MaxBands, _numBands);
+            const auto rate = sampleRate * oversampler.getFactor();
+            auto changed = _numBands != numBands || rate != crossoverRate;
+            for (auto j = 0; j < MaxBands - 1; ++j) {
+                changed = changed || _crossoverHz[j] != crossoverHz[j];
+                crossoverHz[j] = _crossoverHz[j];
+            }
+            for (auto b = 0; b < MaxBands; ++b) {
+                bandSquash[b] = _bandSquash[b];
+                bandGain[b] = juce::Decibels::decibelsToGain(_bandGainDb[b], T(-200));
+            }
+            if (!changed)
+                return;
+            if (_numBands != numBands)
+                stateInvalid = true;
+            numBands = _numBands;
+            crossoverRate = rate;
+            updateCrossover();
+        }
+
+        // in samples of the base rate. first order adaa delays by half a
+        // sample, second order by one, both at the oversampled rate
+        double getLatency() const noexcept
+        {
+            return oversampler.getLatency() + adaaOrder * .5 / oversampler.getFactor();
+        }
+
+        // what the host gets and the dry path is delayed by. rounded up, so
+        // the processed signal never comes out ahead of either, it trails by
+        // the fraction getLatency() has, e.g. half a sample with adaa 1
+        int getLatencySamples() const noexcept
+        {
+            return static_cast<int>(std::ceil(getLatency() - 1e-9));
+        }
+
+        // how long the output can go on after the input stopped, in samples
+        int getTailSamples() const noexcept { return tailSamples; }
+
+        // the samples [offset, offset + numSamples) of channels.
+        // squashV in [0, 1], gainDb in decibels. both get smoothed. linked:
+        // every channel squashes towards the sign of the channels' mean.
+        // bypassed: crossfades to the input, delayed by the latency. silent:
+        // the block's input is at or below the silence floor.
+        // returns true while idle. that's once the input has been silent for
+        // longer than the tail: nothing gets processed, channels stay as they are
+        bool process(T* const* channels, int _numChannels, int offset, int numSamples, T squashV, T gainDb,
+            bool linked, bool bypassed, bool silent) noexcept
+        {
+            if (!isPrepared())
+                return false;
+            silentSamples = silent ? silentSamples + numSamples : 0;
+            if (!bypassed && fade == T(0) && silentSamples >= static_cast<juce::int64>(tailSamples) + numSamples) {
+                // the delay line has to be silent as well, for when this wakes up bypassed
+                if (!idle)
+                    std::fill(dry.begin(), dry.end(), T(0));
+                idle = true;
+                return true;
+            }
+            idle = false;
+
+            const auto numCh = std::min(_numChannels, numChannels);
+            const auto adaa = adaaOrder == 1 ? kernels.adaa1 : kernels.adaa2;
+            const auto factor = oversampler.getFactor();
+
+            for (auto start = 0; start < numSamples; start += maxBlockSize) {
+                const auto n = std::min(maxBlockSize, numSamples - start);
+                for (auto ch = 0; ch < numCh; ++ch)
+                    chunk[ch] = channels[ch] + offset + start;
+                writeDry(numCh, n);
+
+                if (bypassed && fade == T(1)) {
+                    readDry(numCh, n);
+                    dryPos = (dryPos + n) & DryMask;
+                    // the filters start over when the plugin comes back
+                    if (!stateInvalid) {
+                        oversampler.reset();
+                        stateInvalid = true;
+                    }
+                    continue;
+                }
+
+                const auto nOversampled = n * factor;
+                const auto squashRamping = squashSmooth(squashV, nOversampled);
+                const auto gainRamping = gainSmooth(gainDb, nOversampled);
+                const auto ramping = squashRamping || gainRamping;
+
+                // crossover between states, the full blend per sample
+                if (ramping) {
+                    if (!squashRamping)
+                        squashSmooth.fill(nOversampled);
+                    if (!gainRamping)
+                        gainSmooth.fill(nOversampled);
+                    kernels.dbToGain(gainSmooth.data(), nOversampled);
+                }
+                const auto squashCur = squashSmooth.getValue();
+                const auto gainCur = juce::Decibels::decibelsToGain(gainSmooth.getValue());
+                const auto mode = static_cast<int>(getSquashMode(squashCur, gainCur));
+
+                const auto upsampled = oversampler.upsample(chunk.data(), numCh, n);
+
+                const auto holding = isHolding();
+                if (numBands > 1)
+                    squashBands(upsampled, numCh, nOversampled, ramping);
+                else if (linked)
+                    makeLinkTarget(upsampled, numCh, nOversampled, holding);
+                else if (holding)
+                    holdSigns(upsampled, numCh, nOversampled);
+
+                for (auto ch = 0; ch < numCh && numBands == 1; ++ch) {
+                    auto samples = upsampled[ch];
+                    if (adaaOrder != 0) {
+                        auto state = adaaState.data() + 2 * ch;
+                        if (stateInvalid)
+                            state[0] = state[1] = samples[0];
+                        if (linked)
+                            align(samples, nOversampled, state);
+                        else
+                            adaa(samples, target.data(), nOversampled, state);
+                    }
+                    else if (!linked) {
+                        if (curve == Curve::Hard && !holding) {
+                            if (ramping)
+                                kernels.squashRamp(samples, nOversampled, squashSmooth.data(), gainSmooth.data());
+                            else
+                                kernels.squash[mode](samples, nOversampled, squashCur, gainCur);
+                            continue;
+                        }
+                        if (!ramping && mode == static_cast<int>(SquashMode::Bypass))
+                            continue;
+                        if (holding)
+                            readHeld(ch, nOversampled);
+                        else
+                            kernels.shape[static_cast<int>(curve)](samples, target.data(), nOversampled, drive);
+                    }
+                    if (ramping)
+                        kernels.blendRamp(samples, target.data(), nOversampled, squashSmooth.data(), gainSmooth.data());
+                    else
+                        kernels.blend[mode](samples, target.data(), nOversampled, squashCur, gainCur);
+                }
+
+                oversampler.downsample(chunk.data(), numCh, n);
+                stateInvalid = false;
+                wasLinked = linked;
+                wasHolding = holding;
+
+                if (bypassed || fade != T(0))
+                    crossfade(numCh, n, bypassed ? T(1) : T(0));
+                dryPos = (dryPos + n) & DryMask;
+            }
+            return false;
+        }
+
+    protected:
+        const SquashKernels<T>& kernels;
+        Smooth<T> squashSmooth, gainSmooth;
+        Oversampling<T> oversampler;
+        Span<T> target, link, adaaState, linkState;
+        Curve curve;
+        // 1 / knee
+        T drive;
+        // the hysteresis' isa, its channels' frames, lanes interleaved, and
+        // 3 state values per lane, the link's 3 last
+        const SquashKernels<T>* holdKernels;
+        Span<T> held, holdState;
+        // what setHysteresis() got, the counts at the oversampled rate
+        T threshold;
+        double holdMs;
+        T holdSamples, releaseSamples;
+        static constexpr int MaxBands = Bands<T>::MaxBands;
+        Bands<T> bands;
+        // numChannels of Bands::StateSize
+        Span<T> bandState;
+        // what setBands() got, gain linear
+        T crossoverHz[MaxBands - 1], bandSquash[MaxBands], bandGain[MaxBands];
+        // the oversampled rate the crossover's coefs are for
+        double crossoverRate;
+        int numBands;
+        Span<T*> chunk;
+        // numChannels rings of DrySize
+        Span<T> dry;
+        double sampleRate;
+        int numChannels, maxBlockSize, adaaOrder;
+        // where the current chunk's input starts in dry, and how far behind it the bypassed output reads
+        int dryPos, dryDelay;
+        juce::int64 silentSamples;
+        int tailSamples;
+        // 0: processed, 1: bypassed
+        T fade, fadeStep;
+        // the adaa history no longer matches the signal
+        bool stateInvalid, wasLinked, wasHolding, idle;
+        // the bands' squash and gain have been through a block
+        bool bandsPrimed;
+
+        void writeDry(int numCh, int n) noexcept
+        {
+            for (auto ch = 0; ch < numCh; ++ch) {
+                auto ring = dry.data() + ch * DrySize;
+                for (auto s = 0; s < n; ++s)
+                    ring[(dryPos + s) & DryMask] = chunk[ch][s];
+            }
+        }
+
+        void readDry(int numCh, int n) noexcept
+        {
+            for (auto ch = 0; ch < numCh; ++ch) {
+                const auto ring = dry.data() + ch * DrySize;
+                for (auto s = 0; s < n; ++s)
+                    chunk[ch][s] = ring[(dryPos - dryDelay + s) & DryMask];
+            }
+        }
+
+        // the processed chunk towards the delayed input, fade ramping to dest
+        void crossfade(int numCh, int n, T dest) noexcept
+        {
+            const auto step = dest > fade ? fadeStep : -fadeStep;
+            auto f = fade;
+            for (auto ch = 0; ch < numCh; ++ch) {
+                const auto ring = dry.data() + ch * DrySize;
+                f = fade;
+                for (auto s = 0; s < n; ++s) {
+                    f = step > T(0) ? std::min(dest, f + step) : std::max(dest, f + step);
+                    const auto x = chunk[ch][s];
+                    chunk[ch][s] = x + f * (ring[(dryPos - dryDelay + s) & DryMask] - x);
+                }
+            }
+            fade = numCh == 0 ? dest : f;
+        }
+
+        // lane b of section j: highpass if j < b, lowpass if j == b, allpass
+        // if j > b, see multibandBlock. linkwitz riley, so the highpass and
+        // lowpass are 2 butterworth biquads each and the allpass is one
+        void updateCrossover() noexcept
+        {
+            const auto numCrossovers = numBands - 1;
+            double freqs[MaxBands - 1];
+            for (auto j = 0; j < numCrossovers; ++j)
+                freqs[j] = juce::jlimit(10., .45 * crossoverRate, static_cast<double>(crossoverHz[j]));
+            std::sort(freqs, freqs + numCrossovers);
+
+            bands.numBiquads = 2 * numCrossovers;
+            for (auto j = 0; j < numCrossovers; ++j) {
+                const auto k = std::tan(juce::MathConstants<double>::pi * freqs[j] / crossoverRate);
+                const auto sqrt2 = juce::MathConstants<double>::sqrt2;
+                const auto norm = 1. / (1. + sqrt2 * k + k * k);
+                const auto a1 = 2. * (k * k - 1.) * norm;
+                const auto a2 = (1. - sqrt2 * k + k * k) * norm;
+                const double lowpass[5] = { k * k * norm, 2. * k * k * norm, k * k * norm, a1, a2 };
+                const double highpass[5] = { norm, -2. * norm, norm, a1, a2 };
+                const double allpass[5] = { a2, a1, 1., a1, a2 };
+                const double identity[5] = { 1., 0., 0., 0., 0. };
+                const double zero[5] = { 0., 0., 0., 0., 0. };
+                for (auto b = 0; b < MaxBands; ++b) {
+                    const auto first = b >= numBands ? zero : j < b ? highpass : j == b ? lowpass : allpass;
+                    const auto second = b >= numBands ? zero : j < b ? highpass : j == b ? lowpass : identity;
+                    for (auto c = 0; c < 5; ++c) {
+                        bands.coefs[2 * j][c][b] = static_cast<T>(first[c]);
+                        bands.coefs[2 * j + 1][c][b] = static_cast<T>(second[c]);
+                    }
+                }
+            }
+        }
+
+        // every channel through the multiband kernel. the bands' squash and
+        // gain ramp from the last chunk's values to setBands()'
+        void squashBands(T* const* samples, int numCh, int numSamples, bool ramping) noexcept
+        {
+            if (!ramping) {
+                squashSmooth.fill(numSamples);
+                gainSmooth.fill(numSamples);
+                kernels.dbToGain(gainSmooth.data(), numSamples);
+            }
+            for (auto b = 0; b < MaxBands; ++b) {
+                bands.squash[0][b] = bandsPrimed ? bands.squash[1][b] : bandSquash[b];
+                bands.gain[0][b] = bandsPrimed ? bands.gain[1][b] : bandGain[b];
+                bands.squash[1][b] = bandSquash[b];
+                bands.gain[1][b] = bandGain[b];
+            }
+            bandsPrimed = true;
+            if (stateInvalid)
+                std::fill(bandState.begin(), bandState.end(), T(0));
+
+            const auto multiband = kernels.multiband[static_cast<int>(curve)];
+            for (auto ch = 0; ch < numCh; ++ch)
+                multiband(samples[ch], numSamples, squashSmooth.data(), gainSmooth.data(),
+                    bands, drive, bandState.data() + ch * Bands<T>::StateSize);
+        }
+
+        bool isHolding() const noexcept
+        {
+            return (threshold > T(0) || holdSamples > T(1)) && curve == Curve::Hard && adaaOrder == 0 && numBands == 1;
+        }
+
+        // the hysteresis' sign of every channel into held, a group of lanes
+        // channels at a time. unused lanes get silence
+        void holdSigns(const T* const* samples, int numCh, int numSamples) noexcept
+        {
+            const auto lanes = holdKernels->lanes;
+            if (stateInvalid || !wasHolding || wasLinked)
+                std::fill(holdState.begin(), holdState.end(), T(0));
+            for (auto group = 0; group * lanes < numCh; ++group) {
+                auto frames = held.data() + group * lanes * numSamples;
+                for (auto lane = 0; lane < lanes; ++lane) {
+                    const auto ch = group * lanes + lane;
+                    for (auto s = 0; s < numSamples; ++s)
+                        frames[s * lanes + lane] = ch < numCh ? samples[ch][s] : T(0);
+                }
+                holdKernels->hysteresis(frames, frames, numSamples, threshold, holdSamples, releaseSamples,
+                    holdState.data() + 3 * group * lanes);
+            }
+        }
+
+        // target = channel ch's lane of held
+        void readHeld(int ch, int numSamples) noexcept
+        {
+            const auto lanes = holdKernels->lanes;
+            const auto frames = held.data() + ch / lanes * lanes * numSamples;
+            const auto lane = ch % lanes;
+            for (auto s = 0; s < numSamples; ++s)
+                target[s] = frames[s * lanes + lane];
+        }
+
+        // target = the curve of the mean of all channels, antialiased like
+        // the unlinked signal would be, or held by the hysteresis
+        void makeLinkTarget(const T* const* samples, int numCh, int numSamples, bool holding) noexcept
+        {
+            const auto gain = T(1) / static_cast<T>(numCh);
+            std::copy(samples[0], samples[0] + numSamples, link.begin());
+            for (auto ch = 1; ch < numCh; ++ch)
+                for (auto s = 0; s < numSamples; ++s)
+                    link[s] += samples[ch][s];
+            for (auto s = 0; s < numSamples; ++s)
+                link[s] *= gain;
+
+            if (holding) {
+                // one lane, in the scalar kernel
+                const auto state = holdState.end() - 3;
+                if (stateInvalid || !wasLinked || !wasHolding)
+                    std::fill(state, holdState.end(), T(0));
+                getKernels<T>(ISA::Scalar).hysteresis(link.data(), target.data(), numSamples,
+                    threshold, holdSamples, releaseSamples, state);
+                return;
+            }
+            if (adaaOrder == 0) {
+                kernels.shape[static_cast<int>(curve)](link.data(), target.data(), numSamples, drive);
+                return;
+            }
+            if (stateInvalid || !wasLinked)
+                linkState[0] = linkState[1] = link[0];
+            const auto adaa = adaaOrder == 1 ? kernels.adaa1 : kernels.adaa2;
+            adaa(link.data(), target.data(), numSamples, linkState.data());
+        }
+
+        // delays samples like the adaa kernels do, without computing a target
+        void align(T* samples, int numSamples, T* state) const noexcept
+        {
+            const auto x1Next = samples[numSamples - 1];
+            const auto x2Next = numSamples > 1 ? samples[numSamples - 2] : state[0];
+            for (auto s = numSamples - 1; s >= 0; --s) {
+                const auto x1 = s > 0 ? samples[s - 1] : state[0];
+                samples[s] = adaaOrder == 1 ? (samples[s] + x1) * T(.5) : x1;
+            }
+            state[0] = x1Next;
+            state[1] = x2Next;
+        }
+    };
+}
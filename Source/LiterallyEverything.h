@@ -1,22 +1,57 @@
 #pragma once
+#include "Meter.h"
+#include "Scope.h"
+#include "Profiler.h"
 
 static constexpr float pi = 3.14159265359f;
 static constexpr float tau = pi * 2.f;
 
 namespace param {
-	enum class ID { Squash, Gain };
+	// new ids go before NumIDs. the binary state stores parameters in this order
+	enum class ID { Squash, Gain, AntiAlias, Oversampling, OversamplingOffline, OversamplingFilter, Link, SilenceFloor, Curve, Knee,
+		Bands, Crossover1, Crossover2, Crossover3,
+		Band1Squash, Band2Squash, Band3Squash, Band4Squash, Band1Gain, Band2Gain, Band3Gain, Band4Gain,
+		Hysteresis, Hold, NumIDs };
+	static constexpr int NumIDs = static_cast<int>(ID::NumIDs);
+
+	// the bottom of the silence floor's range only counts digital silence
+	static constexpr float SilenceFloorMin = -120.f;
+	// and the bottom of the hysteresis' range turns it off
+	static constexpr float HysteresisMin = -100.f;
 
 	// PARAMETER ID STUFF
 	static juce::String getName(ID i) {
 		switch (i) {
 		case ID::Squash: return "Squash";
 		case ID::Gain: return "Gain";
+		case ID::AntiAlias: return "Anti Alias";
+		case ID::Oversampling: return "Oversampling";
+		case ID::OversamplingOffline: return "Oversampling Offline";
+		case ID::OversamplingFilter: return "Oversampling Filter";
+		case ID::Link: return "Link";
+		case ID::SilenceFloor: return "Silence Floor";
+		case ID::Curve: return "Curve";
+		case ID::Knee: return "Knee";
+		case ID::Bands: return "Bands";
+		case ID::Crossover1: return "Crossover 1";
+		case ID::Crossover2: return "Crossover 2";
+		case ID::Crossover3: return "Crossover 3";
+		case ID::Band1Squash: return "Band 1 Squash";
+		case ID::Band2Squash: return "Band 2 Squash";
+		case ID::Band3Squash: return "Band 3 Squash";
+		case ID::Band4Squash: return "Band 4 Squash";
+		case ID::Band1Gain: return "Band 1 Gain";
+		case ID::Band2Gain: return "Band 2 Gain";
+		case ID::Band3Gain: return "Band 3 Gain";
+		case ID::Band4Gain: return "Band 4 Gain";
+		case ID::Hysteresis: return "Hysteresis";
+		case ID::Hold: return "Hold";
 		default: return "";
 		}
 	}
-	static juce::String getName(int i) { getName(static_cast<ID>(i)); }
+	static juce::String getName(int i) { return getName(static_cast<ID>(i)); }
 	static juce::String getID(const ID i) { return getName(i).toLowerCase().removeCharacters(" "); }
-	static juce::String getID(const int i) { return getName(i).toLowerCase().removeCharacters(" "); }
+	static juce::String getID(const int i) { return getID(static_cast<ID>(i)); }
 
 	namespace makeRange
 	{
@@ -70,9 +105,59 @@ namespace param {
 
 		const auto percStr = [](float v,int) { return juce::String(std::floor(v * 100.f)) + " %"; };
 		const auto dbStr = [](float v,int) { return juce::String(std::floor(v * 100.f) * .01f) + " db"; };
+		const auto antiAliasStr = [](float v, int) {
+			const auto order = static_cast<int>(v + .5f);
+			return order == 0 ? juce::String("off") : "adaa " + juce::String(order);
+		};
+		const auto oversamplingStr = [](float v, int) {
+			const auto order = static_cast<int>(v + .5f);
+			return order == 0 ? juce::String("off") : juce::String(1 << order) + "x";
+		};
+		const auto filterStr = [](float v, int) { return juce::String(v < .5f ? "min phase" : "linear phase"); };
+		const auto onOffStr = [](float v, int) { return juce::String(v < .5f ? "off" : "on"); };
+		const auto curveStr = [](float v, int) {
+			switch (static_cast<int>(v + .5f)) {
+			case 1: return juce::String("soft");
+			case 2: return juce::String("cubic");
+			case 3: return juce::String("asymmetric");
+			default: return juce::String("hard");
+			}
+		};
+		const auto bandsStr = [](float v, int) {
+			const auto bands = static_cast<int>(v + .5f);
+			return bands < 2 ? juce::String("off") : juce::String(bands) + " bands";
+		};
+		const auto hzStr = [](float v, int) {
+			return v < 1000.f ? juce::String(std::round(v)) + " hz" : juce::String(std::round(v * .01f) * .1f) + " khz";
+		};
+		const auto floorStr = [](float v, int) {
+			return v <= SilenceFloorMin ? juce::String("digital silence") : juce::String(std::floor(v)) + " db";
+		};
+		const auto hysteresisStr = [](float v, int) {
+			return v <= HysteresisMin ? juce::String("off") : juce::String(std::floor(v)) + " db";
+		};
+		const auto msStr = [](float v, int) { return juce::String(std::round(v * 100.f) * .01f) + " ms"; };
 
 		parameters.push_back(createParameter(ID::Squash, 100.f, percStr, makeRange::biased(0.f, 100.f, -.6f)));
 		parameters.push_back(createParameter(ID::Gain,   0.f,   dbStr,   makeRange::biased(-40.f, 0.f, 0.f)));
+		parameters.push_back(createParameter(ID::AntiAlias, 0.f, antiAliasStr, 0.f, 2.f, 1.f));
+		parameters.push_back(createParameter(ID::Oversampling, 0.f, oversamplingStr, 0.f, 4.f, 1.f));
+		parameters.push_back(createParameter(ID::OversamplingOffline, 0.f, oversamplingStr, 0.f, 4.f, 1.f));
+		parameters.push_back(createParameter(ID::OversamplingFilter, 0.f, filterStr, 0.f, 1.f, 1.f));
+		parameters.push_back(createParameter(ID::Link, 0.f, onOffStr, 0.f, 1.f, 1.f));
+		parameters.push_back(createParameter(ID::SilenceFloor, SilenceFloorMin, floorStr, SilenceFloorMin, -60.f, 1.f));
+		parameters.push_back(createParameter(ID::Curve, 0.f, curveStr, 0.f, 3.f, 1.f));
+		parameters.push_back(createParameter(ID::Knee, 50.f, percStr, 1.f, 100.f));
+		parameters.push_back(createParameter(ID::Bands, 1.f, bandsStr, 1.f, 4.f, 1.f));
+		parameters.push_back(createParameter(ID::Crossover1, 150.f, hzStr, makeRange::biased(20.f, 20000.f, -.8f)));
+		parameters.push_back(createParameter(ID::Crossover2, 1000.f, hzStr, makeRange::biased(20.f, 20000.f, -.8f)));
+		parameters.push_back(createParameter(ID::Crossover3, 6000.f, hzStr, makeRange::biased(20.f, 20000.f, -.8f)));
+		for (auto b = 0; b < 4; ++b)
+			parameters.push_back(createParameter(static_cast<ID>(static_cast<int>(ID::Band1Squash) + b), 100.f, percStr, 0.f, 100.f));
+		for (auto b = 0; b < 4; ++b)
+			parameters.push_back(createParameter(static_cast<ID>(static_cast<int>(ID::Band1Gain) + b), 0.f, dbStr, -24.f, 24.f));
+		parameters.push_back(createParameter(ID::Hysteresis, HysteresisMin, hysteresisStr, HysteresisMin, -20.f, 1.f));
+		parameters.push_back(createParameter(ID::Hold, 0.f, msStr, makeRange::biased(0.f, 20.f, -.6f)));
 		
 		return { parameters.begin(), parameters.end() };
 	}
@@ -90,6 +175,16 @@ inline void repaintWithChildren(juce::Component* comp) {
         comp->getChildComponent(c)->repaint();
 }
 
+// the embedded font, loaded once and shared while anything uses it
+struct SharedTypeface
+{
+    SharedTypeface() :
+        typeface(juce::Typeface::createSystemTypefaceFor(BinaryData::nel19_ttf, BinaryData::nel19_ttfSize))
+    {}
+
+    juce::Typeface::Ptr typeface;
+};
+
 struct Comp :
     public juce::Component
 {
@@ -97,8 +192,70 @@ struct Comp :
     {}
 };
 
+// coalesces repaints to one per display frame. clients mark themselves
+// dirty as often as parameters change and repaint what changed on flush.
+// runs on vblank where juce has it, otherwise on a timer at 60 hz
+struct RepaintScheduler
+#if JUCE_MAJOR_VERSION < 7
+    : private juce::Timer
+#endif
+{
+    struct Client
+    {
+        virtual ~Client() {}
+        virtual void flushRepaint() = 0;
+    };
+
+    RepaintScheduler(juce::Component& comp) :
+#if JUCE_MAJOR_VERSION >= 7
+        vblank(&comp, [this]() { flush(); }),
+#endif
+        clients(),
+        dirtyComps()
+    {
+#if JUCE_MAJOR_VERSION < 7
+        juce::ignoreUnused(comp);
+        startTimerHz(60);
+#endif
+    }
+
+    void add(Client& client) { clients.push_back(&client); }
+    void remove(Client& client) { clients.erase(std::remove(clients.begin(), clients.end(), &client), clients.end()); }
+
+    // repaints all of comp with the next frame
+    void markDirty(juce::Component& comp)
+    {
+        for (const auto& c : dirtyComps)
+            if (c.getComponent() == &comp)
+                return;
+        dirtyComps.push_back(&comp);
+    }
+
+protected:
+#if JUCE_MAJOR_VERSION >= 7
+    juce::VBlankAttachment vblank;
+#endif
+    std::vector<Client*> clients;
+    std::vector<juce::Component::SafePointer<juce::Component>> dirtyComps;
+
+    void flush()
+    {
+        for (auto& c : dirtyComps)
+            if (auto comp = c.getComponent())
+                comp->repaint();
+        dirtyComps.clear();
+        for (auto client : clients)
+            client->flushRepaint();
+    }
+
+#if JUCE_MAJOR_VERSION < 7
+    void timerCallback() override { flush(); }
+#endif
+};
+
 class Knob :
-    public Comp
+    public Comp,
+    private RepaintScheduler::Client
 {
     static constexpr float StartAngle = -pi * .25f * 3.f;
     static constexpr float EndAngle = pi * .25f * 3.f;
@@ -112,22 +269,95 @@ class Knob :
     {
         Dial(Knob& _knob) :
             Comp(),
-            knob(_knob)
+            knob(_knob),
+            arcs(),
+            arcsCol(),
+            arcsScale(0.f),
+            value(0.f)
         {
             setInterceptsMouseClicks(false, false);
         }
+
+        // repaints only the area the indicator covers at the old or new value
+        void setValue(float _value)
+        {
+            if (_value == value)
+                return;
+            const auto area = getIndicatorBounds(value).getUnion(getIndicatorBounds(_value));
+            value = _value;
+            repaint(area.getSmallestIntegerContainer());
+        }
     protected:
         const Knob& knob;
+        // both arcs, rendered once per size, scale and colour
+        juce::Image arcs;
+        juce::Colour arcsCol;
+        float arcsScale, value;
+
         void paint(juce::Graphics& g) override
+        {
+            const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+            if (arcs.isNull() || arcsCol != knob.mainCol || arcsScale != scale)
+                renderArcs(scale);
+            g.drawImage(arcs, getLocalBounds().toFloat());
+
+            g.setColour(knob.mainCol);
+            for (auto r = 0; r <= 24; ++r)
+                g.drawRect(getIndicatorRect(value, r), 3.f);
+        }
+
+        // the r-th of the 25 rects the value indicator is made of
+        juce::Rectangle<float> getIndicatorRect(float v, int r) const
         {
             const auto width = static_cast<float>(getWidth());
             const auto height = static_cast<float>(getHeight());
-            const auto value = knob.rap.getValue();
-            juce::PathStrokeType strokeType(thicc, juce::PathStrokeType::JointStyle::curved, juce::PathStrokeType::EndCapStyle::rounded);
             const juce::Point<float> centre(width * .5f, height * .5f);
             const auto radius = std::min(centre.x, centre.y) - thicc;
             const auto angleRange = EndAngle - StartAngle;
-            const auto valueAngle = StartAngle + angleRange * value;
+
+            auto rr = 1.f * r / 24.f;
+            const auto vLine = juce::Line<float>::fromStartAndAngle(centre, radius + 1.f, StartAngle + angleRange * v * rr);
+            auto x = vLine.getStartX();
+            auto y = vLine.getStartX();
+            auto endX = vLine.getEndX();
+            auto endY = vLine.getEndY();
+            if (x > endX) std::swap(x, endX);
+            if (y > endY) std::swap(y, endY);
+            auto w = endX - x;
+            auto h = endY - y;
+            return { x, y, w, h };
+        }
+
+        juce::Rectangle<float> getIndicatorBounds(float v) const
+        {
+            auto bounds = getIndicatorRect(v, 0);
+            for (auto r = 1; r <= 24; ++r)
+                bounds = bounds.getUnion(getIndicatorRect(v, r));
+            // antialiasing bleeds a pixel past the rects
+            return bounds.expanded(1.f);
+        }
+
+        void resized() override
+        {
+            arcs = juce::Image();
+        }
+
+        void renderArcs(float scale)
+        {
+            const auto width = static_cast<float>(getWidth());
+            const auto height = static_cast<float>(getHeight());
+            arcs = juce::Image(juce::Image::ARGB,
+                std::max(1, juce::roundToInt(width * scale)),
+                std::max(1, juce::roundToInt(height * scale)),
+                true);
+            arcsCol = knob.mainCol;
+            arcsScale = scale;
+
+            juce::Graphics g{ arcs };
+            g.addTransform(juce::AffineTransform::scale(scale));
+            juce::PathStrokeType strokeType(thicc, juce::PathStrokeType::JointStyle::curved, juce::PathStrokeType::EndCapStyle::rounded);
+            const juce::Point<float> centre(width * .5f, height * .5f);
+            const auto radius = std::min(centre.x, centre.y) - thicc;
 
             g.setColour(knob.mainCol);
             juce::Path pathNorm;
@@ -141,21 +371,6 @@ class Knob :
                 true
             );
             g.strokePath(pathNorm, strokeType);
-
-            g.setColour(knob.mainCol);
-            for (auto r = 0; r <= 24.f; ++r) {
-                auto rr = 1.f * r / 24.f;
-                const auto vLine = juce::Line<float>::fromStartAndAngle(centre, radius + 1.f, StartAngle + angleRange * value * rr);
-                auto x = vLine.getStartX();
-                auto y = vLine.getStartX();
-                auto endX = vLine.getEndX();
-                auto endY = vLine.getEndY();
-                if (x > endX) std::swap(x, endX);
-                if (y > endY) std::swap(y, endY);
-                auto w = endX - x;
-                auto h = endY - y;
-                g.drawRect(x,y,w,h, 3.f);
-            }
         }
     };
 
@@ -163,37 +378,59 @@ class Knob :
         public Comp
     {
         Label(const juce::String& _name) :
-            Comp()
+            Comp(),
+            font()
         {
             setName(_name);
         }
     protected:
+        juce::SharedResourcePointer<SharedTypeface> font;
+
         void paint(juce::Graphics& g) override {
             g.setColour(juce::Colours::white);
-            g.setFont(juce::Typeface::createSystemTypefaceFor(BinaryData::nel19_ttf, BinaryData::nel19_ttfSize));
+            g.setFont(font->typeface);
             g.drawFittedText(getName(), getLocalBounds(), juce::Justification::centred, 1);
         }
     };
 public:
-    Knob(juce::AudioProcessorValueTreeState& apvts, param::ID _pID, const juce::String& _name) :
+    Knob(juce::AudioProcessorValueTreeState& apvts, param::ID _pID, const juce::String& _name, RepaintScheduler& _scheduler) :
+        scheduler(_scheduler),
         rap(*apvts.getParameter(param::getID(_pID))),
-        attach(rap, [this](float) { repaint(); }, nullptr),
+        attach(rap, [this](float) { dirty = true; }, nullptr),
         dial(*this),
         label(_name),
         dragY(0.f),
-        scrollSpeed(0.f)
+        scrollSpeed(0.f),
+        dirty(false)
     {
         addAndMakeVisible(dial);
         addAndMakeVisible(label);
         attach.sendInitialUpdate();
+        dial.setValue(rap.getValue());
+        scheduler.add(*this);
+    }
+    ~Knob() override
+    {
+        scheduler.remove(*this);
     }
     juce::Colour mainCol;
 protected:
+    RepaintScheduler& scheduler;
     juce::RangedAudioParameter& rap;
     juce::ParameterAttachment attach;
     Dial dial;
     Label label;
     float dragY, scrollSpeed;
+    // the parameter moved since the last frame
+    bool dirty;
+
+    void flushRepaint() override
+    {
+        if (!dirty)
+            return;
+        dirty = false;
+        dial.setValue(rap.getValue());
+    }
 
     void mouseDown(const juce::MouseEvent& evt) override {
         attach.beginGesture();
@@ -277,4 +514,250 @@ private:
             return [](float) {};
         return [this](float) { repaint(); };
     }
-};
\ No newline at end of file
+};
+
+// input meter at the left edge, output meter at the right. rms as a bar,
+// the peak as a line that falls back slowly, the dc offset as a tick.
+// polled once per frame, repaints only the bars
+class LevelMeters :
+    public Comp,
+    private RepaintScheduler::Client
+{
+    static constexpr float MinDb = -60.f, MaxDb = 6.f;
+    // peak hold falloff per frame
+    static constexpr float PeakFall = .95f;
+    static constexpr int NumSignals = dsp::Meter::NumSignals;
+public:
+    LevelMeters(dsp::Meter& _meter, RepaintScheduler& _scheduler) :
+        meter(_meter),
+        scheduler(_scheduler),
+        levels(),
+        peak(), rms(), dc()
+    {
+        setInterceptsMouseClicks(false, false);
+        // whatever piled up while the editor was closed
+        meter.fetch(levels);
+        scheduler.add(*this);
+    }
+    ~LevelMeters() override
+    {
+        scheduler.remove(*this);
+    }
+    juce::Colour mainCol;
+protected:
+    dsp::Meter& meter;
+    RepaintScheduler& scheduler;
+    dsp::Meter::Levels levels;
+    // what's on screen, as gain
+    float peak[NumSignals], rms[NumSignals], dc[NumSignals];
+
+    void flushRepaint() override
+    {
+        const auto fetched = meter.fetch(levels);
+        for (auto s = 0; s < NumSignals; ++s) {
+            const auto signal = static_cast<dsp::Meter::Signal>(s);
+            auto newPeak = peak[s] * PeakFall;
+            auto newRms = rms[s], newDc = dc[s];
+            if (fetched) {
+                newPeak = std::max(newPeak, static_cast<float>(levels.getPeak(signal)));
+                newRms = static_cast<float>(levels.getRMS(signal));
+                newDc = static_cast<float>(levels.getDC(signal));
+            }
+            if (toY(newPeak) == toY(peak[s]) && toY(newRms) == toY(rms[s]) && toY(std::abs(newDc)) == toY(std::abs(dc[s]))) {
+                peak[s] = newPeak;
+                continue;
+            }
+            peak[s] = newPeak;
+            rms[s] = newRms;
+            dc[s] = newDc;
+            repaint(getBarBounds(s).toNearestIntEdges());
+        }
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        for (auto s = 0; s < NumSignals; ++s) {
+            const auto bar = getBarBounds(s);
+            g.setColour(juce::Colours::black.withAlpha(.4f));
+            g.fillRect(bar);
+            g.setColour(mainCol);
+            g.fillRect(bar.withTop(toY(rms[s])));
+            g.setColour(mainCol.contrasting(.5f));
+            g.fillRect(bar.withTop(toY(peak[s])).withHeight(2.f));
+            g.setColour(juce::Colours::white);
+            g.fillRect(bar.withTop(toY(std::abs(dc[s]))).withHeight(1.f).withTrimmedLeft(bar.getWidth() * .5f));
+        }
+    }
+
+    juce::Rectangle<float> getBarBounds(int s) const
+    {
+        const auto width = static_cast<float>(getWidth());
+        const auto height = static_cast<float>(getHeight());
+        const auto barWidth = std::max(4.f, width * .025f);
+        const auto x = s == dsp::Meter::Input ? 0.f : width - barWidth;
+        return { x, 0.f, barWidth, height };
+    }
+
+    // pixel row of a gain, snapped so unchanged rows don't repaint
+    float toY(float gain) const
+    {
+        const auto db = juce::Decibels::gainToDecibels(gain, MinDb);
+        const auto norm = juce::jlimit(0.f, 1.f, (db - MinDb) / (MaxDb - MinDb));
+        return std::round(static_cast<float>(getHeight()) * (1.f - norm));
+    }
+};
+
+// the input and the squashed output on top of each other, as min/max bands
+// per pixel column. the paths only get rebuilt when new samples arrived,
+// paint just fills them. the processor only captures while this exists
+class ScopeView :
+    public Comp,
+    private RepaintScheduler::Client
+{
+    // samples on screen
+    static constexpr int NumSamples = 2048;
+    // how far back the input's latest rising zero crossing gets searched,
+    // so periodic signals stand still
+    static constexpr int TriggerRange = 2048;
+    static constexpr int NumSignals = dsp::Scope::NumSignals;
+public:
+    ScopeView(dsp::Scope& _scope, RepaintScheduler& _scheduler) :
+        scope(_scope),
+        scheduler(_scheduler),
+        samples(),
+        paths(),
+        lastPos(_scope.getWritePos())
+    {
+        setInterceptsMouseClicks(false, false);
+        for (auto& s : samples)
+            s.resize(static_cast<size_t>(NumSamples + TriggerRange));
+        scope.setActive(true);
+        scheduler.add(*this);
+    }
+    ~ScopeView() override
+    {
+        scheduler.remove(*this);
+        scope.setActive(false);
+    }
+    juce::Colour mainCol;
+protected:
+    dsp::Scope& scope;
+    RepaintScheduler& scheduler;
+    std::vector<float> samples[NumSignals];
+    juce::Path paths[NumSignals];
+    juce::uint32 lastPos;
+
+    void flushRepaint() override
+    {
+        const auto end = scope.getWritePos();
+        if (end == lastPos || getWidth() == 0)
+            return;
+        lastPos = end;
+        for (auto s = 0; s < NumSignals; ++s)
+            scope.read(static_cast<dsp::Scope::Signal>(s), end, samples[s].data(), NumSamples + TriggerRange);
+
+        const auto& input = samples[dsp::Scope::Input];
+        auto start = TriggerRange;
+        for (auto t = TriggerRange; t > 0; --t)
+            if (input[t - 1] <= 0.f && input[t] > 0.f) {
+                start = t;
+                break;
+            }
+        for (auto s = 0; s < NumSignals; ++s)
+            makePath(paths[s], samples[s].data() + start);
+        repaint();
+    }
+
+    void resized() override
+    {
+        // rebuilt for the new width with the next samples
+        lastPos = scope.getWritePos() - 1;
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        g.setColour(juce::Colours::black.withAlpha(.3f));
+        g.fillRect(getLocalBounds());
+        g.setColour(juce::Colours::white.withAlpha(.35f));
+        g.fillPath(paths[dsp::Scope::Input]);
+        g.setColour(mainCol.brighter(1.f).withAlpha(.8f));
+        g.fillPath(paths[dsp::Scope::Output]);
+    }
+
+    // along the maxima left to right, back along the minima
+    void makePath(juce::Path& path, const float* x) const
+    {
+        const auto width = getWidth();
+        const auto centre = static_cast<float>(getHeight()) * .5f;
+        const auto toY = [centre](float v) { return centre - centre * juce::jlimit(-1.f, 1.f, v); };
+        const auto getRange = [x, width](int c) {
+            const auto s0 = c * NumSamples / width;
+            const auto s1 = std::max(s0 + 1, (c + 1) * NumSamples / width);
+            auto mm = std::minmax_element(x + s0, x + s1);
+            return std::make_pair(*mm.first, *mm.second);
+        };
+
+        path.clear();
+        path.startNewSubPath(0.f, toY(getRange(0).second));
+        for (auto c = 1; c < width; ++c)
+            path.lineTo(static_cast<float>(c), toY(getRange(c).second));
+        // a flat band still covers one pixel
+        for (auto c = width - 1; c >= 0; --c)
+            path.lineTo(static_cast<float>(c), toY(getRange(c).first) + 1.f);
+        path.closeSubPath();
+    }
+};
+
+// one line of the instance's dsp load along the bottom edge: median, p99
+// and max of processBlock's time against the block's budget, and how often
+// it ran over. refreshed a few times per second
+class ProfileView :
+    public Comp,
+    private RepaintScheduler::Client
+{
+    static constexpr int FramesPerUpdate = 15;
+public:
+    ProfileView(const dsp::Profiler& _profiler, RepaintScheduler& _scheduler) :
+        profiler(_profiler),
+        scheduler(_scheduler),
+        font(),
+        text(),
+        frame(0)
+    {
+        setInterceptsMouseClicks(false, false);
+        scheduler.add(*this);
+    }
+    ~ProfileView() override
+    {
+        scheduler.remove(*this);
+    }
+protected:
+    const dsp::Profiler& profiler;
+    RepaintScheduler& scheduler;
+    juce::SharedResourcePointer<SharedTypeface> font;
+    juce::String text;
+    int frame;
+
+    void flushRepaint() override
+    {
+        if (++frame < FramesPerUpdate)
+            return;
+        frame = 0;
+        const auto s = profiler.getSnapshot();
+        const auto perc = [](double load) { return juce::String(load * 100., 1) + "%"; };
+        auto newText = s.numBlocks == 0
+            ? juce::String("dsp idle")
+            : "dsp " + perc(s.median) + " p99 " + perc(s.p99) + " max " + perc(s.max) + " overruns " + juce::String(static_cast<juce::int64>(s.numOverruns));
+        if (newText == text)
+            return;
+        text = newText;
+        repaint();
+    }
+
+    void paint(juce::Graphics& g) override
+    {
+        g.setColour(juce::Colours::white.withAlpha(.5f));
+        g.setFont(juce::Font(font->typeface).withHeight(static_cast<float>(getHeight())));
+        g.drawFittedText(text, getLocalBounds(), juce::Justification::centred, 1);
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+#include "Squash.h"
+
+namespace dsp
+{
+    // hands values from one producer thread to one consumer thread without
+    // locks. the producer writes a slot of its own and swaps it with the
+    // middle one, the consumer swaps the middle one with its own slot when
+    // it's newer. one atomic exchange per publish and per fetch, wait-free
+    template<typename T>
+    struct TripleBuffer
+    {
+        TripleBuffer() :
+            slots(),
+            back(0), front(1),
+            middle(2)
+        {}
+
+        // producer: the slot to fill before publish()
+        T& write() noexcept { return slots[back]; }
+
+        void publish() noexcept
+        {
+            back = middle.exchange(back | FreshBit, std::memory_order_acq_rel) & IndexMask;
+        }
+
+        // consumer: true if something was published since the last fetch.
+        // read() holds the latest value either way
+        bool fetch() noexcept
+        {
+            if ((middle.load(std::memory_order_relaxed) & FreshBit) == 0)
+                return false;
+            front = middle.exchange(front, std::memory_order_acq_rel) & IndexMask;
+            return true;
+        }
+
+        const T& read() const noexcept { return slots[front]; }
+
+    protected:
+        static constexpr int IndexMask = 3, FreshBit = 4;
+        std::array<T, 3> slots;
+        int back, front;
+        std::atomic<int> middle;
+    };
+
+    // input and output levels from the audio thread to the editor. every
+    // block gets added to what the editor hasn't fetched yet, so it sees
+    // every peak no matter how seldom it polls. the audio thread does a
+    // vectorized pass per channel and two atomics per block
+    struct Meter
+    {
+        enum Signal { Input, Output, NumSignals };
+
+        struct Stats
+        {
+            double peak, sumSq, sum;
+        };
+
+        struct Levels
+        {
+            Stats stats[NumSignals];
+            // samples of all channels added into each signal's stats
+            juce::int64 numSamples;
+            juce::uint32 id;
+
+            double getPeak(Signal s) const noexcept { return stats[s].peak; }
+            double getRMS(Signal s) const noexcept { return numSamples == 0 ? 0. : std::sqrt(stats[s].sumSq / numSamples); }
+            // the mean. pure sign output carries a lot of it
+            double getDC(Signal s) const noexcept { return numSamples == 0 ? 0. : stats[s].sum / numSamples; }
+        };
+
+        Meter() :
+            buffer(),
+            levels(),
+            fetchedId(0)
+        {
+            levels.id = 1;
+        }
+
+        // audio thread, once per block before measure()
+        void startBlock(int numChannels, int numSamples) noexcept
+        {
+            // the editor took the last levels, start over
+            if (fetchedId.load(std::memory_order_acquire) == levels.id) {
+                const auto id = levels.id + 1;
+                levels = {};
+                levels.id = id;
+            }
+            levels.numSamples += static_cast<juce::int64>(numChannels) * numSamples;
+        }
+
+        // returns the block's peak over all channels
+        template<typename T>
+        T measure(Signal signal, const T* const* channels, int numChannels, int numSamples) noexcept
+        {
+            const auto& kernels = getKernels<T>();
+            auto& stats = levels.stats[signal];
+            auto peak = T(0);
+            for (auto ch = 0; ch < numChannels; ++ch) {
+                T block[3] = { T(0), T(0), T(0) };
+                kernels.measure(channels[ch], numSamples, block);
+                peak = std::max(peak, block[0]);
+                stats.sumSq += block[1];
+                stats.sum += block[2];
+            }
+            stats.peak = std::max(stats.peak, static_cast<double>(peak));
+            return peak;
+        }
+
+        // audio thread, once per block after measure()
+        void publish() noexcept
+        {
+            buffer.write() = levels;
+            buffer.publish();
+        }
+
+        // message thread. true if levels changed since the last call
+        bool fetch(Levels& l) noexcept
+        {
+            if (!buffer.fetch())
+                return false;
+            l = buffer.read();
+            fetchedId.store(l.id, std::memory_order_release);
+            return true;
+        }
+
+    protected:
+        TripleBuffer<Levels> buffer;
+        // audio thread only
+        Levels levels;
+        std::atomic<juce::uint32> fetchedId;
+    };
+}
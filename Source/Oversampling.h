@@ -0,0 +1,410 @@
+#pragma once
+#include <JuceHeader.h>
+#include <complex>
+#include "Squash.h"
+#include "Arena.h"
+
+namespace dsp
+{
+    // half-band filter design. transitions are relative to the higher rate,
+    // the band edge sits at a quarter of it.
+    namespace halfband
+    {
+        // polyphase allpass coefficients, laurent de soras' design (hiir).
+        // even coefficients go to the first path, odd ones to the second
+        inline std::vector<double> designIIR(int numCoefs, double transition)
+        {
+            const auto ipow = [](double x, int n) {
+                auto y = 1.;
+                for (; n > 0; n >>= 1, x *= x)
+                    if (n & 1)
+                        y *= x;
+                return y;
+            };
+            const auto pi = juce::MathConstants<double>::pi;
+            auto k = std::tan((1. - transition * 2.) * pi * .25);
+            k *= k;
+            const auto kksqrt = std::pow(1. - k * k, .25);
+            const auto e = .5 * (1. - kksqrt) / (1. + kksqrt);
+            const auto e4 = e * e * e * e;
+            const auto q = e * (1. + e4 * (2. + e4 * (15. + 150. * e4)));
+            const auto order = numCoefs * 2 + 1;
+
+            std::vector<double> coefs(static_cast<size_t>(numCoefs));
+            for (auto i = 0; i < numCoefs; ++i) {
+                const auto c = i + 1;
+                auto num = 0., den = 0., term = 0.;
+                for (auto j = 0, sgn = 1; j == 0 || std::abs(term) > 1e-100; ++j, sgn = -sgn) {
+                    term = ipow(q, j * (j + 1)) * std::sin((j * 2 + 1) * c * pi / order) * sgn;
+                    num += term;
+                }
+                for (auto j = 1, sgn = -1; j == 1 || std::abs(term) > 1e-100; ++j, sgn = -sgn) {
+                    term = ipow(q, j * j) * std::cos(j * 2 * c * pi / order) * sgn;
+                    den += term;
+                }
+                const auto ww = num * std::pow(q, .25) / (den + .5);
+                const auto wwsq = ww * ww;
+                const auto x = std::sqrt((1. - wwsq * k) * (1. - wwsq / k)) / (1. + wwsq);
+                coefs[i] = (1. - x) / (1. + x);
+            }
+            return coefs;
+        }
+
+        // group delay near dc of the allpass pair, in samples of the higher rate
+        inline double getDelayIIR(const std::vector<double>& coefs)
+        {
+            using Complex = std::complex<double>;
+            static constexpr double W = 1e-4;
+            const auto z2 = std::exp(Complex(0., -2. * W));
+            Complex a0(1.), a1(1.);
+            for (size_t i = 0; i < coefs.size(); ++i)
+                (i % 2 == 0 ? a0 : a1) *= (coefs[i] + z2) / (1. + coefs[i] * z2);
+            return -std::arg(a0 + std::exp(Complex(0., -W)) * a1) / W;
+        }
+
+        // the non-zero taps of a linear phase half-band, kaiser windowed sinc,
+        // numTaps = 4k + 3. the centre tap is .5 and everything at an even
+        // distance from it is 0, so only the odd distances get stored
+        inline std::vector<double> designFIR(int numTaps, double attenuationDb)
+        {
+            jassert(numTaps % 4 == 3);
+            const auto beta = .1102 * (attenuationDb - 8.7);
+            const auto centre = (numTaps - 1) / 2;
+            const auto besselI0 = [](double x) {
+                auto sum = 1., term = 1.;
+                for (auto k = 1; term > 1e-12 * sum; ++k) {
+                    term *= (x * .5 / k) * (x * .5 / k);
+                    sum += term;
+                }
+                return sum;
+            };
+
+            std::vector<double> taps;
+            auto sum = 0.;
+            for (auto i = 0; i < numTaps; i += 2) {
+                const auto d = static_cast<double>(i - centre);
+                const auto r = d / centre;
+                const auto window = besselI0(beta * std::sqrt(1. - r * r)) / besselI0(beta);
+                const auto piHalfD = juce::MathConstants<double>::halfPi * d;
+                taps.push_back(.5 * std::sin(piHalfD) / piHalfD * window);
+                sum += taps.back();
+            }
+            for (auto& t : taps)
+                t *= .5 / sum;
+            return taps;
+        }
+    }
+
+    // 2x up- and downsampling with the polyphase allpass pair. minimum phase.
+    // works on frames of interleaved channels, one group of lanes channels
+    // at a time, so the recursion of all of them shares one register
+    template<typename T>
+    struct HalfBandIIR
+    {
+        HalfBandIIR() :
+            coefs(), upState(), downState(), numCoefs(0), stateSize(0), latency(0.)
+        {}
+
+        void prepare(Arena& arena, const std::vector<double>& c, int numGroups, int lanes)
+        {
+            numCoefs = static_cast<int>(c.size());
+            jassert(numCoefs <= SquashKernels<T>::MaxAllpasses);
+            latency = halfband::getDelayIIR(c);
+            coefs = arena.take<T>(c.size());
+            std::copy(c.begin(), c.end(), coefs.begin());
+            stateSize = numCoefs * 2 * lanes;
+            upState = arena.take<T>(static_cast<size_t>(numGroups * stateSize));
+            downState = arena.take<T>(upState.size());
+        }
+
+        void reset() noexcept
+        {
+            std::fill(upState.begin(), upState.end(), T(0));
+            std::fill(downState.begin(), downState.end(), T(0));
+        }
+
+        // out holds 2 * numFrames frames
+        void up(const T* in, T* out, int numFrames, int group, const SquashKernels<T>& k) noexcept
+        {
+            k.halfBandUp(in, out, numFrames, coefs.data(), numCoefs, upState.data() + group * stateSize);
+        }
+
+        // in holds 2 * numFrames frames
+        void down(const T* in, T* out, int numFrames, int group, const SquashKernels<T>& k) noexcept
+        {
+            k.halfBandDown(in, out, numFrames, coefs.data(), numCoefs, downState.data() + group * stateSize);
+        }
+
+        // one filter, in samples of the higher rate
+        double getLatency() const noexcept { return latency; }
+
+    protected:
+        Span<T> coefs, upState, downState;
+        int numCoefs, stateSize;
+        double latency;
+    };
+
+    // 2x up- and downsampling with a linear phase half-band, polyphase,
+    // so only the non-zero taps get computed
+    template<typename T>
+    struct HalfBandFIR
+    {
+        HalfBandFIR() :
+            taps(), upHistory(), downHistory(), scratch(), numTaps(0), delay(0)
+        {}
+
+        void prepare(Arena& arena, const std::vector<double>& t, int numChannels, int maxBlockSize)
+        {
+            numTaps = static_cast<int>(t.size());
+            delay = numTaps / 2 - 1;
+            // reversed, so the convolution below runs forwards over both arrays
+            taps = arena.take<T>(t.size());
+            std::copy(t.rbegin(), t.rend(), taps.begin());
+            upHistory = arena.take<T>(static_cast<size_t>(numChannels * numTaps));
+            downHistory = arena.take<T>(static_cast<size_t>(numChannels * (numTaps + delay + 1)));
+            scratch = arena.take<T>(static_cast<size_t>(2 * (numTaps + maxBlockSize)));
+        }
+
+        void reset() noexcept
+        {
+            std::fill(upHistory.begin(), upHistory.end(), T(0));
+            std::fill(downHistory.begin(), downHistory.end(), T(0));
+        }
+
+        // out holds 2 * numSamples. even outputs are the convolution with the
+        // sinc taps, odd outputs the input delayed to the centre tap
+        void up(const T* in, T* out, int numSamples, int ch) noexcept
+        {
+            const auto histLen = numTaps - 1;
+            auto hist = upHistory.data() + ch * numTaps;
+            auto w = scratch.data();
+            std::copy(hist, hist + histLen, w);
+            std::copy(in, in + numSamples, w + histLen);
+            for (auto s = 0; s < numSamples; ++s) {
+                const auto x = w + s;
+                auto y = T(0);
+                for (auto k = 0; k < numTaps; ++k)
+                    y += taps[k] * x[k];
+                out[2 * s] = T(2) * y;
+                out[2 * s + 1] = x[histLen - delay];
+            }
+            std::copy(w + numSamples, w + numSamples + histLen, hist);
+        }
+
+        // in holds 2 * numSamples
+        void down(const T* in, T* out, int numSamples, int ch) noexcept
+        {
+            const auto evenLen = numTaps - 1;
+            const auto oddLen = delay + 1;
+            auto evenHist = downHistory.data() + ch * (numTaps + delay + 1);
+            auto oddHist = evenHist + evenLen;
+            auto even = scratch.data();
+            auto odd = even + evenLen + numSamples;
+            std::copy(evenHist, evenHist + evenLen, even);
+            std::copy(oddHist, oddHist + oddLen, odd);
+            for (auto s = 0; s < numSamples; ++s) {
+                even[evenLen + s] = in[2 * s];
+                odd[oddLen + s] = in[2 * s + 1];
+            }
+            for (auto s = 0; s < numSamples; ++s) {
+                const auto x = even + s;
+                auto y = T(0);
+                for (auto k = 0; k < numTaps; ++k)
+                    y += taps[k] * x[k];
+                out[s] = y + T(.5) * odd[s];
+            }
+            std::copy(even + numSamples, even + numSamples + evenLen, evenHist);
+            std::copy(odd + numSamples, odd + numSamples + oddLen, oddHist);
+        }
+
+        // up and down together, in samples of the higher rate
+        double getLatency() const noexcept { return 2. * (2 * delay + 1); }
+
+    protected:
+        Span<T> taps, upHistory, downHistory, scratch;
+        int numTaps, delay;
+    };
+
+    // cascade of 2x half-band stages, up to 16x. every buffer and filter for
+    // both filter types and all factors is taken from the arena in prepare(), so
+    // switching at runtime only resets state. the minimum phase path runs
+    // channels in groups interleaved into simd lanes, with the narrowest isa
+    // that fits all channels into one group, the widest one otherwise
+    template<typename T>
+    struct Oversampling
+    {
+        enum class Filter { MinPhase, LinearPhase };
+        static constexpr int MaxOrder = 4;
+
+        Oversampling() :
+            iir(), fir(), buffers(), frames(), channels(),
+            kernels(&getKernels<T>(ISA::Scalar)),
+            maxBlockSize(0), bufferSize(0), order(0),
+            filter(Filter::MinPhase)
+        {}
+
+        void prepare(Arena& arena, int numChannels, int _maxBlockSize)
+        {
+            maxBlockSize = _maxBlockSize;
+            bufferSize = maxBlockSize << MaxOrder;
+
+            for (auto i = 0; i <= static_cast<int>(getISA()); ++i) {
+                kernels = &getKernels<T>(static_cast<ISA>(i));
+                if (kernels->lanes >= numChannels)
+                    break;
+            }
+            const auto lanes = kernels->lanes;
+            const auto numGroups = (numChannels + lanes - 1) / lanes;
+
+            // the first stage guards the audible band, later ones only
+            // have to reject what lies above the previous stage's band
+            for (auto i = 0; i < MaxOrder; ++i) {
+                const auto blockSize = maxBlockSize << i;
+                if (i == 0) {
+                    iir[i].prepare(arena, halfband::designIIR(8, .05), numGroups, lanes);
+                    fir[i].prepare(arena, halfband::designFIR(127, 100.), numChannels, blockSize);
+                }
+                else {
+                    iir[i].prepare(arena, halfband::designIIR(4, .2), numGroups, lanes);
+                    fir[i].prepare(arena, halfband::designFIR(31, 100.), numChannels, blockSize);
+                }
+            }
+            buffers = arena.take<T>(static_cast<size_t>(2 * numChannels * bufferSize));
+            frames = arena.take<T>(static_cast<size_t>(2 * lanes * bufferSize));
+            channels = arena.take<T*>(static_cast<size_t>(numChannels));
+            reset();
+        }
+
+        void reset() noexcept
+        {
+            for (auto i = 0; i < MaxOrder; ++i) {
+                iir[i].reset();
+                fir[i].reset();
+            }
+        }
+
+        // doesn't allocate. resets the filters if anything changed
+        void setOrder(int _order, Filter _filter) noexcept
+        {
+            _order = juce::jlimit(0, MaxOrder, _order);
+            if (_order == order && _filter == filter)
+                return;
+            order = _order;
+            filter = _filter;
+            reset();
+        }
+
+        int getOrder() const noexcept { return order; }
+        int getFactor() const noexcept { return 1 << order; }
+        Filter getFilter() const noexcept { return filter; }
+
+        // in samples of the base rate. the minimum phase filters report
+        // their group delay at low frequencies
+        double getLatency() const noexcept
+        {
+            auto latency = 0.;
+            for (auto i = 0; i < order; ++i) {
+                // the downsampler's allpass pair starts on the odd input, one sample early
+                const auto stageLatency = filter == Filter::MinPhase ? 2. * iir[i].getLatency() - 1. : fir[i].getLatency();
+                latency += stageLatency / static_cast<double>(2 << i);
+            }
+            return latency;
+        }
+
+        // returns the oversampled channels, numSamples << getOrder() long.
+        // without oversampling that's in itself. numChannels <= the prepared number
+        T* const* upsample(T* const* in, int numChannels, int numSamples) noexcept
+        {
+            if (order == 0) {
+                std::copy(in, in + numChannels, channels.begin());
+                return channels.data();
+            }
+            for (auto ch = 0; ch < numChannels; ++ch)
+                channels[ch] = getBuffer(ch, (order - 1) % 2);
+
+            if (filter == Filter::MinPhase) {
+                const auto lanes = kernels->lanes;
+                for (auto group = 0; group * lanes < numChannels; ++group) {
+                    interleave(in, getFrames(0), numChannels, numSamples, group);
+                    for (auto i = 0; i < order; ++i)
+                        iir[i].up(getFrames(i % 2), getFrames((i + 1) % 2), numSamples << i, group, *kernels);
+                    deinterleave(getFrames(order % 2), channels.data(), numChannels, numSamples << order, group);
+                }
+            }
+            else {
+                for (auto ch = 0; ch < numChannels; ++ch) {
+                    const T* src = in[ch];
+                    for (auto i = 0; i < order; ++i) {
+                        auto dest = getBuffer(ch, i % 2);
+                        fir[i].up(src, dest, numSamples << i, ch);
+                        src = dest;
+                    }
+                }
+            }
+            return channels.data();
+        }
+
+        // takes the channels upsample() returned back down into out
+        void downsample(T* const* out, int numChannels, int numSamples) noexcept
+        {
+            if (order == 0)
+                return;
+
+            if (filter == Filter::MinPhase) {
+                const auto lanes = kernels->lanes;
+                for (auto group = 0; group * lanes < numChannels; ++group) {
+                    interleave(channels.data(), getFrames(order % 2), numChannels, numSamples << order, group);
+                    for (auto i = order - 1; i >= 0; --i)
+                        iir[i].down(getFrames((i + 1) % 2), getFrames(i % 2), numSamples << i, group, *kernels);
+                    deinterleave(getFrames(0), out, numChannels, numSamples, group);
+                }
+            }
+            else {
+                for (auto ch = 0; ch < numChannels; ++ch) {
+                    for (auto i = order - 1; i >= 0; --i) {
+                        const auto src = getBuffer(ch, i % 2);
+                        auto dest = i == 0 ? out[ch] : getBuffer(ch, (i - 1) % 2);
+                        fir[i].down(src, dest, numSamples << i, ch);
+                    }
+                }
+            }
+        }
+
+    protected:
+        HalfBandIIR<T> iir[MaxOrder];
+        HalfBandFIR<T> fir[MaxOrder];
+        Span<T> buffers, frames;
+        Span<T*> channels;
+        const SquashKernels<T>* kernels;
+        int maxBlockSize, bufferSize, order;
+        Filter filter;
+
+        T* getBuffer(int ch, int idx) noexcept { return buffers.data() + (2 * ch + idx) * bufferSize; }
+        T* getFrames(int idx) noexcept { return frames.data() + idx * kernels->lanes * bufferSize; }
+
+        // unused lanes of the last group get silence
+        void interleave(const T* const* src, T* dest, int numChannels, int numSamples, int group) const noexcept
+        {
+            const auto lanes = kernels->lanes;
+            const auto first = group * lanes;
+            for (auto lane = 0; lane < lanes; ++lane) {
+                const auto ch = first + lane;
+                if (ch < numChannels)
+                    for (auto s = 0; s < numSamples; ++s)
+                        dest[s * lanes + lane] = src[ch][s];
+                else
+                    for (auto s = 0; s < numSamples; ++s)
+                        dest[s * lanes + lane] = T(0);
+            }
+        }
+
+        void deinterleave(const T* src, T* const* dest, int numChannels, int numSamples, int group) const noexcept
+        {
+            const auto lanes = kernels->lanes;
+            const auto first = group * lanes;
+            for (auto lane = 0; lane < lanes && first + lane < numChannels; ++lane)
+                for (auto s = 0; s < numSamples; ++s)
+                    dest[first + lane][s] = src[s * lanes + lane];
+        }
+    };
+}
@@ -0,0 +1,310 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Squash.h"
+
+namespace packed
+{
+    // .sqb: audio that only takes the values gain, -gain and 0, which is
+    // what a full squash with the hard curve puts out, at 1 bit per sample
+    // with runs of equal words collapsed. little endian, version 1:
+    //
+    // header, 32 bytes
+    //  0  magic 'sqbf'
+    //  4  version, uint16
+    //  6  number of channels, uint16
+    //  8  sample rate, float64
+    // 16  samples per channel, uint64, 0 until the writer is done
+    // 24  samples per chunk, uint32
+    // 28  reserved, 0
+    //
+    // then chunks of up to that many samples
+    //  0  size of the chunk with this header, uint32
+    //  4  samples in the chunk, uint32
+    //  8  gain, float32
+    // 12  per channel: the size of its records, uint32, then the records
+    //
+    // a record is a varint count << 3 | kind, count in words of 64 samples.
+    // Literal: count sign words follow, every sample is gain or -gain.
+    // Positive, Negative, Silent: count words of gain, -gain or 0. Mixed:
+    // count pairs of sign and nonzero words follow. bits past the chunk's
+    // samples are 0
+    static constexpr juce::uint32 Magic = 0x66627173; // "sqbf"
+    static constexpr juce::uint16 Version = 1;
+    static constexpr int ChunkSize = 1 << 16, WordsPerChunk = ChunkSize / 64;
+    static constexpr size_t HeaderSize = 32, ChunkHeaderSize = 12;
+
+    enum class Kind { Literal, Positive, Negative, Silent, Mixed, NumKinds };
+
+    template<typename T>
+    inline void write(juce::uint8* d, T v) noexcept
+    {
+        for (size_t b = 0; b < sizeof(T); ++b)
+            d[b] = static_cast<juce::uint8>(v >> (8 * b));
+    }
+    template<typename T>
+    inline T read(const juce::uint8* d) noexcept
+    {
+        T v = 0;
+        for (size_t b = 0; b < sizeof(T); ++b)
+            v |= static_cast<T>(d[b]) << (8 * b);
+        return v;
+    }
+    template<typename Bits, typename F>
+    inline void writeFloat(juce::uint8* d, F v) noexcept
+    {
+        Bits bits;
+        std::memcpy(&bits, &v, sizeof(F));
+        write(d, bits);
+    }
+    template<typename Bits, typename F>
+    inline F readFloat(const juce::uint8* d) noexcept
+    {
+        const auto bits = read<Bits>(d);
+        F v;
+        std::memcpy(&v, &bits, sizeof(F));
+        return v;
+    }
+
+    struct Header
+    {
+        int numChannels;
+        double sampleRate;
+        std::uint64_t numSamples;
+        int chunkSize;
+
+        void write(juce::uint8* d) const noexcept
+        {
+            packed::write(d, Magic);
+            packed::write(d + 4, Version);
+            packed::write(d + 6, static_cast<juce::uint16>(numChannels));
+            writeFloat<std::uint64_t>(d + 8, sampleRate);
+            packed::write(d + 16, numSamples);
+            packed::write(d + 24, static_cast<juce::uint32>(chunkSize));
+            packed::write(d + 28, juce::uint32(0));
+        }
+
+        // false if it's not a header this can read
+        bool read(const juce::uint8* d) noexcept
+        {
+            if (packed::read<juce::uint32>(d) != Magic || packed::read<juce::uint16>(d + 4) != Version)
+                return false;
+            numChannels = packed::read<juce::uint16>(d + 6);
+            sampleRate = readFloat<std::uint64_t, double>(d + 8);
+            numSamples = packed::read<std::uint64_t>(d + 16);
+            chunkSize = static_cast<int>(packed::read<juce::uint32>(d + 24));
+            return numChannels > 0 && sampleRate > 0. && chunkSize > 0 && chunkSize % 64 == 0;
+        }
+    };
+
+    inline void writeVarint(std::vector<juce::uint8>& out, std::uint64_t v)
+    {
+        for (; v >= 0x80; v >>= 7)
+            out.push_back(static_cast<juce::uint8>(v | 0x80));
+        out.push_back(static_cast<juce::uint8>(v));
+    }
+
+    inline bool readVarint(const juce::uint8* data, size_t size, size_t& pos, std::uint64_t& v) noexcept
+    {
+        v = 0;
+        for (auto shift = 0; shift < 64 && pos < size; shift += 7) {
+            const auto b = data[pos++];
+            v |= static_cast<std::uint64_t>(b & 0x7f) << shift;
+            if ((b & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }
+
+    inline Kind classify(std::uint64_t signs, std::uint64_t nonzero) noexcept
+    {
+        if (nonzero == 0)
+            return Kind::Silent;
+        if (nonzero != ~std::uint64_t(0))
+            return Kind::Mixed;
+        return signs == ~std::uint64_t(0) ? Kind::Positive : signs == 0 ? Kind::Negative : Kind::Literal;
+    }
+
+    // one channel's words as records
+    inline void encode(const std::uint64_t* signs, const std::uint64_t* nonzero, int numWords, std::vector<juce::uint8>& out)
+    {
+        for (auto w = 0; w < numWords;) {
+            const auto kind = classify(signs[w], nonzero[w]);
+            auto end = w + 1;
+            while (end < numWords && classify(signs[end], nonzero[end]) == kind)
+                ++end;
+            writeVarint(out, static_cast<std::uint64_t>(end - w) << 3 | static_cast<std::uint64_t>(kind));
+            if (kind == Kind::Literal || kind == Kind::Mixed)
+                for (; w < end; ++w) {
+                    const auto pos = out.size();
+                    out.resize(pos + (kind == Kind::Mixed ? 16 : 8));
+                    write(out.data() + pos, signs[w]);
+                    if (kind == Kind::Mixed)
+                        write(out.data() + pos + 8, nonzero[w]);
+                }
+            w = end;
+        }
+    }
+
+    // the records back into numWords words, false if they don't add up to that
+    inline bool decode(const juce::uint8* data, size_t size, std::uint64_t* signs, std::uint64_t* nonzero, int numWords) noexcept
+    {
+        size_t pos = 0;
+        for (auto w = 0; w < numWords;) {
+            std::uint64_t record;
+            if (!readVarint(data, size, pos, record))
+                return false;
+            const auto kind = static_cast<Kind>(record & 7);
+            const auto count = record >> 3;
+            if (kind >= Kind::NumKinds || count == 0 || count > static_cast<std::uint64_t>(numWords - w))
+                return false;
+            const auto end = w + static_cast<int>(count);
+            if (kind == Kind::Literal || kind == Kind::Mixed) {
+                const auto wordSize = kind == Kind::Mixed ? size_t(16) : size_t(8);
+                if (size - pos < count * wordSize)
+                    return false;
+                for (; w < end; ++w, pos += wordSize) {
+                    signs[w] = read<std::uint64_t>(data + pos);
+                    nonzero[w] = kind == Kind::Mixed ? read<std::uint64_t>(data + pos + 8) : ~std::uint64_t(0);
+                }
+            }
+            else {
+                const auto s = kind == Kind::Positive ? ~std::uint64_t(0) : std::uint64_t(0);
+                const auto nz = kind == Kind::Silent ? std::uint64_t(0) : ~std::uint64_t(0);
+                std::fill(signs + w, signs + end, s);
+                std::fill(nonzero + w, nonzero + end, nz);
+                w = end;
+            }
+        }
+        return pos == size;
+    }
+
+    // collects a chunk of samples and turns it into bytes
+    struct Packer
+    {
+        Packer(int _numChannels) :
+            kernels(dsp::getKernels<float>()),
+            numChannels(_numChannels),
+            staged(static_cast<size_t>(numChannels * ChunkSize)),
+            check(ChunkSize),
+            signs(WordsPerChunk),
+            nonzero(WordsPerChunk),
+            numStaged(0)
+        {}
+
+        // how many of numSamples fit into the chunk. channels may be nullptr, that's silence
+        int stage(const float* const* channels, int offset, int numSamples)
+        {
+            const auto n = std::min(numSamples, ChunkSize - numStaged);
+            for (auto ch = 0; ch < numChannels; ++ch) {
+                auto dest = staged.data() + ch * ChunkSize + numStaged;
+                if (channels[ch] != nullptr)
+                    std::copy(channels[ch] + offset, channels[ch] + offset + n, dest);
+                else
+                    std::fill(dest, dest + n, 0.f);
+            }
+            numStaged += n;
+            return n;
+        }
+
+        bool isFull() const noexcept { return numStaged == ChunkSize; }
+        bool isEmpty() const noexcept { return numStaged == 0; }
+        int getNumStaged() const noexcept { return numStaged; }
+
+        // appends the chunk to out and starts the next. false if a sample
+        // isn't gain, -gain or 0, then nothing got appended
+        bool pack(std::vector<juce::uint8>& out)
+        {
+            auto gain = 0.f;
+            for (auto ch = 0; ch < numChannels && gain == 0.f; ++ch) {
+                const auto samples = staged.data() + ch * ChunkSize;
+                const auto x = std::find_if(samples, samples + numStaged, [](float v) { return v != 0.f; });
+                gain = x == samples + numStaged ? 0.f : std::abs(*x);
+            }
+            const auto numWords = (numStaged + 63) / 64;
+
+            const auto start = out.size();
+            out.resize(start + ChunkHeaderSize);
+            for (auto ch = 0; ch < numChannels; ++ch) {
+                const auto samples = staged.data() + ch * ChunkSize;
+                kernels.pack(samples, numStaged, signs.data(), nonzero.data());
+                // whatever unpacks to something else can't be stored
+                kernels.unpack(check.data(), numStaged, signs.data(), nonzero.data(), 0, gain);
+                if (!std::equal(check.begin(), check.begin() + numStaged, samples)) {
+                    out.resize(start);
+                    return false;
+                }
+                const auto sizePos = out.size();
+                out.resize(sizePos + 4);
+                encode(signs.data(), nonzero.data(), numWords, out);
+                write(out.data() + sizePos, static_cast<juce::uint32>(out.size() - sizePos - 4));
+            }
+            write(out.data() + start, static_cast<juce::uint32>(out.size() - start));
+            write(out.data() + start + 4, static_cast<juce::uint32>(numStaged));
+            writeFloat<juce::uint32>(out.data() + start + 8, gain);
+            numStaged = 0;
+            return true;
+        }
+
+    protected:
+        const dsp::SquashKernels<float>& kernels;
+        int numChannels;
+        std::vector<float> staged, check;
+        std::vector<std::uint64_t> signs, nonzero;
+        int numStaged;
+    };
+
+    // holds one chunk as bits and expands any part of it into samples
+    struct Unpacker
+    {
+        Unpacker(int _numChannels) :
+            kernels(dsp::getKernels<float>()),
+            numChannels(_numChannels),
+            signs(static_cast<size_t>(numChannels * WordsPerChunk)),
+            nonzero(signs.size()),
+            numSamples(0),
+            gain(0.f)
+        {}
+
+        // a whole chunk with its header, false if it's broken
+        bool load(const juce::uint8* data, size_t size) noexcept
+        {
+            numSamples = 0;
+            if (size < ChunkHeaderSize || packed::read<juce::uint32>(data) != size)
+                return false;
+            const auto n = static_cast<int>(packed::read<juce::uint32>(data + 4));
+            if (n <= 0 || n > ChunkSize)
+                return false;
+            gain = packed::readFloat<juce::uint32, float>(data + 8);
+            size_t pos = ChunkHeaderSize;
+            for (auto ch = 0; ch < numChannels; ++ch) {
+                if (size - pos < 4)
+                    return false;
+                const auto recordsSize = static_cast<size_t>(packed::read<juce::uint32>(data + pos));
+                pos += 4;
+                if (size - pos < recordsSize
+                    || !decode(data + pos, recordsSize, signs.data() + ch * WordsPerChunk, nonzero.data() + ch * WordsPerChunk, (n + 63) / 64))
+                    return false;
+                pos += recordsSize;
+            }
+            numSamples = n;
+            return pos == size;
+        }
+
+        int getNumSamples() const noexcept { return numSamples; }
+        float getGain() const noexcept { return gain; }
+
+        // numSamples of a channel from sample first of the chunk on
+        void read(float* dest, int channel, int first, int n) const noexcept
+        {
+            jassert(first + n <= numSamples);
+            kernels.unpack(dest, n, signs.data() + channel * WordsPerChunk, nonzero.data() + channel * WordsPerChunk, first, gain);
+        }
+
+    protected:
+        const dsp::SquashKernels<float>& kernels;
+        int numChannels;
+        std::vector<std::uint64_t> signs, nonzero;
+        int numSamples;
+        float gain;
+    };
+}
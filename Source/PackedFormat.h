@@ -0,0 +1,226 @@
+#pragma once
+#include <JuceHeader.h>
+#include "Packed.h"
+
+namespace packed
+{
+    static inline const juce::String FormatName { "Squashed Bits" };
+
+    // writes .sqb from float samples. write() fails as soon as a chunk holds
+    // a sample that isn't gain, -gain or 0, e.g. when squash isn't 100 %.
+    // flush() packs what's left, so the end of the file can fail too
+    // while there's someone to tell
+    struct Writer :
+        public juce::AudioFormatWriter
+    {
+        Writer(juce::OutputStream* out, double _sampleRate, unsigned int _numChannels) :
+            juce::AudioFormatWriter(out, FormatName, _sampleRate, _numChannels, 32),
+            packer(static_cast<int>(_numChannels)),
+            bytes(),
+            headerPos(out->getPosition()),
+            numWritten(0),
+            failed(false)
+        {
+            usesFloatingPointData = true;
+            writeHeader();
+        }
+
+        ~Writer() override
+        {
+            if (!failed && !packer.isEmpty())
+                packChunk();
+            // streams that can't seek keep 0. readers count the chunks then,
+            // and only see a broken one, not a missing one at the end
+            const auto end = output->getPosition();
+            if (output->setPosition(headerPos)) {
+                writeHeader();
+                output->setPosition(end);
+            }
+            output->flush();
+        }
+
+        // float data, it only says int
+        bool write(const int** samplesToWrite, int numSamples) override
+        {
+            if (failed)
+                return false;
+            const auto channels = reinterpret_cast<const float* const*>(samplesToWrite);
+            for (auto offset = 0; offset < numSamples;) {
+                offset += packer.stage(channels, offset, numSamples - offset);
+                if (packer.isFull() && !packChunk())
+                    return false;
+            }
+            return true;
+        }
+
+        // ends the chunk early
+        bool flush() override
+        {
+            if (failed || (!packer.isEmpty() && !packChunk()))
+                return false;
+            output->flush();
+            return true;
+        }
+
+    protected:
+        Packer packer;
+        std::vector<juce::uint8> bytes;
+        juce::int64 headerPos;
+        std::uint64_t numWritten;
+        bool failed;
+
+        void writeHeader()
+        {
+            juce::uint8 header[HeaderSize];
+            Header { static_cast<int>(numChannels), sampleRate, numWritten, ChunkSize }.write(header);
+            output->write(header, HeaderSize);
+        }
+
+        bool packChunk()
+        {
+            bytes.clear();
+            const auto numStaged = packer.getNumStaged();
+            failed = !packer.pack(bytes) || !output->write(bytes.data(), bytes.size());
+            if (!failed)
+                numWritten += static_cast<std::uint64_t>(numStaged);
+            return !failed;
+        }
+    };
+
+    // reads .sqb as float samples, a chunk at a time. opening it scans the
+    // chunk sizes, so seeking is a lookup. files with a broken chunk, or
+    // with fewer samples than the header says, don't open
+    struct Reader :
+        public juce::AudioFormatReader
+    {
+        Reader(juce::InputStream* in) :
+            juce::AudioFormatReader(in, FormatName),
+            header(),
+            chunks(),
+            unpacker(),
+            chunk(),
+            loaded(-1)
+        {
+            juce::uint8 h[HeaderSize];
+            if (input->read(h, HeaderSize) != static_cast<int>(HeaderSize) || !header.read(h) || header.chunkSize != ChunkSize)
+                return;
+            juce::int64 pos = HeaderSize, numSamples = 0;
+            for (;;) {
+                juce::uint8 c[8];
+                if (!input->setPosition(pos) || input->read(c, 8) != 8)
+                    break;
+                const auto size = packed::read<juce::uint32>(c);
+                const auto n = static_cast<int>(packed::read<juce::uint32>(c + 4));
+                if (size < ChunkHeaderSize || n <= 0 || n > ChunkSize || pos + size > input->getTotalLength())
+                    break;
+                chunks.push_back({ pos, static_cast<int>(size), numSamples });
+                pos += size;
+                numSamples += n;
+            }
+            if (pos != input->getTotalLength()
+                || (header.numSamples != 0 && static_cast<std::uint64_t>(numSamples) != header.numSamples))
+                return;
+            sampleRate = header.sampleRate;
+            numChannels = static_cast<unsigned int>(header.numChannels);
+            bitsPerSample = 32;
+            usesFloatingPointData = true;
+            lengthInSamples = numSamples;
+            unpacker = std::make_unique<Unpacker>(header.numChannels);
+        }
+
+        bool isValid() const noexcept { return unpacker != nullptr; }
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+            juce::int64 startSampleInFile, int numSamples) override
+        {
+            clearSamplesBeyondAvailableLength(destChannels, numDestChannels, startOffsetInDestBuffer,
+                startSampleInFile, numSamples, lengthInSamples);
+            while (numSamples > 0) {
+                const auto next = std::upper_bound(chunks.begin(), chunks.end(), startSampleInFile,
+                    [](juce::int64 sample, const Chunk& c) { return sample < c.firstSample; });
+                const auto index = static_cast<int>(next - chunks.begin()) - 1;
+                if (index < 0 || !load(index))
+                    return false;
+                const auto first = static_cast<int>(startSampleInFile - chunks[static_cast<size_t>(index)].firstSample);
+                const auto n = std::min(numSamples, unpacker->getNumSamples() - first);
+                for (auto ch = 0; ch < numDestChannels; ++ch) {
+                    if (destChannels[ch] == nullptr)
+                        continue;
+                    auto dest = reinterpret_cast<float*>(destChannels[ch]) + startOffsetInDestBuffer;
+                    if (ch < static_cast<int>(numChannels))
+                        unpacker->read(dest, ch, first, n);
+                    else
+                        std::fill(dest, dest + n, 0.f);
+                }
+                startOffsetInDestBuffer += n;
+                startSampleInFile += n;
+                numSamples -= n;
+            }
+            return true;
+        }
+
+    protected:
+        struct Chunk
+        {
+            juce::int64 pos;
+            int size;
+            juce::int64 firstSample;
+        };
+
+        Header header;
+        std::vector<Chunk> chunks;
+        std::unique_ptr<Unpacker> unpacker;
+        juce::MemoryBlock chunk;
+        int loaded;
+
+        bool load(int index)
+        {
+            if (index == loaded)
+                return true;
+            loaded = -1;
+            if (index >= static_cast<int>(chunks.size()))
+                return false;
+            const auto& c = chunks[static_cast<size_t>(index)];
+            chunk.setSize(static_cast<size_t>(c.size), false);
+            if (!input->setPosition(c.pos) || input->read(chunk.getData(), c.size) != c.size
+                || !unpacker->load(static_cast<const juce::uint8*>(chunk.getData()), chunk.getSize()))
+                return false;
+            loaded = index;
+            return true;
+        }
+    };
+
+    // lets an AudioFormatManager read and write .sqb
+    struct Format :
+        public juce::AudioFormat
+    {
+        Format() :
+            juce::AudioFormat(FormatName, ".sqb")
+        {}
+
+        juce::Array<int> getPossibleSampleRates() override { return { 22050, 44100, 48000, 88200, 96000, 176400, 192000 }; }
+        juce::Array<int> getPossibleBitDepths() override { return { 32 }; }
+        bool canDoStereo() override { return true; }
+        bool canDoMono() override { return true; }
+        bool isCompressed() override { return true; }
+
+        juce::AudioFormatReader* createReaderFor(juce::InputStream* in, bool deleteStreamIfOpeningFails) override
+        {
+            auto reader = std::make_unique<Reader>(in);
+            if (reader->isValid())
+                return reader.release();
+            if (!deleteStreamIfOpeningFails)
+                reader->input = nullptr;
+            return nullptr;
+        }
+
+        using juce::AudioFormat::createWriterFor;
+        juce::AudioFormatWriter* createWriterFor(juce::OutputStream* out, double sampleRate, unsigned int numChannels,
+            int, const juce::StringPairArray&, int) override
+        {
+            if (out == nullptr || numChannels == 0 || numChannels > 0xffff)
+                return nullptr;
+            return new Writer(out, sampleRate, numChannels);
+        }
+    };
+}
@@ -1,5 +1,6 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "BinaryData.h"
 
 juce::Colour randCol(juce::Random& rand) {
     return juce::Colour(0xffff0000).withRotatedHue(rand.nextFloat());
@@ -9,54 +10,63 @@ juce::Colour randCol(juce::Colour last, juce::Random& rand, float t) {
     return last.withRotatedHue((rand.nextFloat() - .5f) * t);
 }
 
-juce::Colour getDominantCol(const juce::Image& img) {
-    float r = 0.f, g = 0.f, b = 0.f;
-    for(auto y = 0; y < img.getHeight(); ++y)
-        for (auto x = 0; x < img.getWidth(); ++x) {
-            auto pxl = img.getPixelAt(x, y);
-            r += pxl.getFloatRed();
-            g += pxl.getFloatGreen();
-            b += pxl.getFloatBlue();
+// calls func(yStart, yEnd, band) for bands of rows, on the calling thread and
+// on whichever pool threads are free. the caller works through the bands
+// itself instead of waiting for the pool, so a busy pool only makes it slower
+template<typename Func>
+void forEachRowBand(juce::ThreadPool& pool, int numRows, int rowsPerBand, Func&& func) {
+    struct Bands {
+        std::function<void(int)> run;
+        std::atomic<int> next{ 0 }, done{ 0 };
+        int num = 0;
+    };
+    auto bands = std::make_shared<Bands>();
+    bands->num = (numRows + rowsPerBand - 1) / rowsPerBand;
+    // helpers that start late find no band left, so they never call into a
+    // func that has gone out of scope
+    bands->run = [&func, numRows, rowsPerBand](int b) {
+        const auto yStart = b * rowsPerBand;
+        func(yStart, std::min(numRows, yStart + rowsPerBand), b);
+    };
+    const auto work = [bands]() {
+        for (auto b = bands->next++; b < bands->num; b = bands->next++) {
+            bands->run(b);
+            ++bands->done;
         }
-    auto gain = 1.f / float(img.getWidth() * img.getHeight());
-    r *= gain;
-    g *= gain;
-    b *= gain;
-    return juce::Colour(
-        juce::uint8(r * 128.f),
-        juce::uint8(g * 128.f),
-        juce::uint8(b * 128.f)
-    );
+    };
+    const auto numHelpers = std::min(bands->num, juce::SystemStats::getNumCpus()) - 1;
+    for (auto i = 0; i < numHelpers; ++i)
+        pool.addJob(work);
+    work();
+    while (bands->done.load() < bands->num)
+        juce::Thread::yield();
 }
 
+// flames rising from the bottom, folded towards the edges. runs on a pool
+// thread, returns a null image if cancelled on the way. mainCol becomes the
+// background's average colour, at half brightness. the flames walk the
+// editor's default size and get stretched to the target size, so one seed
+// looks the same at every size
+juce::Image makeBackground(juce::ThreadPool& pool, int width, int height, int seed, juce::Colour& mainCol, const std::atomic<bool>& cancelled) {
+    static constexpr int RowsPerBand = 16;
+    static constexpr float FlameWidth = 339.f, FlameHeight = 431.f;
 
-SusquashAudioProcessorEditor::SusquashAudioProcessorEditor (SusquashAudioProcessor& _p) :
-    AudioProcessorEditor(&_p),
-    p(_p),
-    bg(),
-    mainCol(),
-    subTitle("~ inspired by dan worrall ~", "~ inspired by dan worrall ~"),
-    squash(p.apvts, param::ID::Squash, "SUSQUASH"),
-    gain(p.apvts, param::ID::Gain, "GAIN")
-{
-    auto state = p.apvts.state;
-    
-    const auto width = static_cast<int>(state.getProperty("width", 339));
-    const auto height = static_cast<int>(state.getProperty("height", 431));
-
-    bg = juce::Image(juce::Image::ARGB, width, height, true);
+    // software, so nothing but this thread touches it while drawing
+    juce::Image flames(juce::Image::ARGB, width, height, true, juce::SoftwareImageType());
     {
-        juce::Graphics g{ bg };
-        juce::Random rand;
+        juce::Graphics g{ flames };
+        g.addTransform(juce::AffineTransform::scale(width / FlameWidth, height / FlameHeight));
+        juce::Random rand(seed);
         const auto numFlames = 12.f + rand.nextFloat() * 12.f;
         const auto lineLen = 2.f + rand.nextFloat() * 12.f;
         auto col = randCol(rand);
         for (auto i = 0; i < numFlames; ++i) {
-            auto x = rand.nextFloat() * width;
-            auto y = 1.f * height;
+            if (cancelled.load())
+                return {};
+            auto x = rand.nextFloat() * FlameWidth;
+            auto y = FlameHeight;
             col = randCol(col, rand, .1f);
-            while (x > 0 && x < width && y > 0) {
-                auto yRel = y / height;
+            while (x > 0 && x < FlameWidth && y > 0) {
                 auto angle = rand.nextFloat() * pi - pi * .5f;
                 auto line = juce::Line<float>::fromStartAndAngle({ x,y }, lineLen, angle);
                 col = randCol(col, rand, .1f);
@@ -66,50 +76,211 @@ SusquashAudioProcessorEditor::SusquashAudioProcessorEditor (SusquashAudioProcess
                 y = line.getEndY();
             }
         }
-        auto tmpImg = bg.createCopy();
-        for (auto y = 0; y < height; ++y) {
+    }
+    if (cancelled.load())
+        return {};
+
+    // every pixel takes the one further out, darkened towards the corners.
+    // the rows hold premultiplied argb, where darker() and
+    // withMultipliedAlpha() both just scale the channels
+    std::vector<int> srcX(static_cast<size_t>(width));
+    std::vector<float> xSide(static_cast<size_t>(width));
+    for (auto x = 0; x < width; ++x) {
+        const auto xRel = 1.f * x / width;
+        xSide[x] = std::sqrt(std::sqrt(std::abs(2.f * xRel - 1.f)));
+        srcX[x] = static_cast<int>(xSide[x] * width);
+    }
+    juce::Image img(juce::Image::ARGB, width, height, false, juce::SoftwareImageType());
+    const juce::Image::BitmapData src(flames, juce::Image::BitmapData::readOnly);
+    const juce::Image::BitmapData dest(img, juce::Image::BitmapData::writeOnly);
+    // rgb sums per band, unpremultiplied like getPixelAt would return them
+    std::vector<std::array<float, 3>> sums(static_cast<size_t>((height + RowsPerBand - 1) / RowsPerBand));
+
+    forEachRowBand(pool, height, RowsPerBand, [&](int yStart, int yEnd, int band) {
+        auto& sum = sums[band];
+        sum = { 0.f, 0.f, 0.f };
+        if (cancelled.load())
+            return;
+        for (auto y = yStart; y < yEnd; ++y) {
             const auto yRel = 1.f * y / height;
             const auto ySide = std::sqrt(std::sqrt(std::abs(2.f * yRel - 1.f)));
-            for (auto x = 0; x < width; ++x) {
-                const auto xRel = 1.f * x / width;
-                const auto xSide = std::sqrt(std::sqrt(std::abs(2.f * xRel - 1.f)));
-                tmpImg.setPixelAt(x, y, bg.getPixelAt(xSide * width, ySide * height).darker(ySide * xSide * .4f).withMultipliedAlpha(.8f));
+            const auto srcY = static_cast<int>(ySide * height);
+            auto destPxl = dest.getLinePointer(y);
+            for (auto x = 0; x < width; ++x, destPxl += dest.pixelStride) {
+                auto& out = *reinterpret_cast<juce::PixelARGB*>(destPxl);
+                // getPixelAt reads outside the image as transparent
+                if (srcY >= height || srcX[x] >= width) {
+                    out.setARGB(0, 0, 0, 0);
+                    continue;
+                }
+                const auto& in = *reinterpret_cast<const juce::PixelARGB*>(src.getPixelPointer(srcX[x], srcY));
+                const auto alpha = in.getAlpha();
+                const auto darken = 1.f / (1.f + ySide * xSide[x] * .4f);
+                const auto gain = darken * .8f;
+                out.setARGB(
+                    static_cast<juce::uint8>(alpha * .8f + .5f),
+                    static_cast<juce::uint8>(in.getRed() * gain),
+                    static_cast<juce::uint8>(in.getGreen() * gain),
+                    static_cast<juce::uint8>(in.getBlue() * gain)
+                );
+                if (alpha != 0) {
+                    const auto unpremultiply = darken / alpha;
+                    sum[0] += in.getRed() * unpremultiply;
+                    sum[1] += in.getGreen() * unpremultiply;
+                    sum[2] += in.getBlue() * unpremultiply;
+                }
             }
         }
-        bg = tmpImg;
-        mainCol = getDominantCol(bg);
-        squash.mainCol = mainCol;
-        gain.mainCol = mainCol;
+    });
+    if (cancelled.load())
+        return {};
+
+    float r = 0.f, g = 0.f, b = 0.f;
+    for (const auto& sum : sums) {
+        r += sum[0];
+        g += sum[1];
+        b += sum[2];
     }
+    auto gain = 1.f / float(width * height);
+    mainCol = juce::Colour(
+        juce::uint8(r * gain * 128.f),
+        juce::uint8(g * gain * 128.f),
+        juce::uint8(b * gain * 128.f)
+    );
+    return img;
+}
+
+
+SusquashAudioProcessorEditor::SusquashAudioProcessorEditor (SusquashAudioProcessor& _p) :
+    AudioProcessorEditor(&_p),
+    p(_p),
+    cache(),
+    bgCancelled(std::make_shared<std::atomic<bool>>(false)),
+    seed(0),
+    bg(),
+    // until the background is ready
+    mainCol(0xff5a3a30),
+    repaints(*this),
+    subTitle("~ inspired by dan worrall ~", "~ inspired by dan worrall ~"),
+    squash(p.apvts, param::ID::Squash, "SUSQUASH", repaints),
+    gain(p.apvts, param::ID::Gain, "GAIN", repaints),
+    meters(p.meter, repaints),
+    scope(p.scope, repaints),
+    profile(p.profiler, repaints)
+{
+    auto state = p.apvts.state;
+    
+    const auto width = static_cast<int>(state.getProperty("width", 339));
+    const auto height = static_cast<int>(state.getProperty("height", 431));
+    if (!state.hasProperty("bgseed"))
+        state.setProperty("bgseed", juce::Random::getSystemRandom().nextInt(), nullptr);
+    seed = static_cast<int>(state.getProperty("bgseed"));
+
+    squash.mainCol = mainCol;
+    gain.mainCol = mainCol;
+    meters.mainCol = mainCol;
+    scope.mainCol = mainCol;
 
     addAndMakeVisible(subTitle);
-    subTitle.setFont(juce::Typeface::createSystemTypefaceFor(BinaryData::nel19_ttf, BinaryData::nel19_ttfSize));
+    subTitle.setFont(juce::SharedResourcePointer<SharedTypeface>()->typeface);
     subTitle.setColour(juce::Label::ColourIds::textColourId, mainCol.contrasting());
     subTitle.setJustificationType(juce::Justification::centred);
 
     addAndMakeVisible(squash);
     addAndMakeVisible(gain);
+    addAndMakeVisible(meters);
+    addAndMakeVisible(scope);
+    addAndMakeVisible(profile);
 
     setResizable(true, true);
     setOpaque(true);
     setSize(width, height);
+    // the first size renders right away, not after the resize delay
+    if (bg.isNull()) {
+        stopTimer();
+        generateBackground(width, height);
+    }
+}
+
+SusquashAudioProcessorEditor::~SusquashAudioProcessorEditor()
+{
+    bgCancelled->store(true);
+}
+
+void SusquashAudioProcessorEditor::timerCallback()
+{
+    stopTimer();
+    generateBackground(getWidth(), getHeight());
+}
+
+void SusquashAudioProcessorEditor::generateBackground(int width, int height)
+{
+    bgCancelled->store(true);
+    bgCancelled = std::make_shared<std::atomic<bool>>(false);
+
+    auto& pool = cache->pool;
+    juce::Component::SafePointer<SusquashAudioProcessorEditor> editor(this);
+    pool.addJob([&pool, width, height, s = seed, cancelled = bgCancelled, editor]() {
+        BackgroundCache::Entry entry{ s, width, height, {}, {} };
+        entry.img = makeBackground(pool, width, height, s, entry.mainCol, *cancelled);
+        if (entry.img.isNull())
+            return;
+        juce::MessageManager::callAsync([editor, entry]() {
+            if (auto e = editor.getComponent())
+                e->setBackground(entry);
+        });
+    });
+}
+
+void SusquashAudioProcessorEditor::setBackground(BackgroundCache::Entry entry)
+{
+    cache->add(entry);
+    // a render for a size the editor already left still beats the placeholder
+    if (!bg.isNull() && (entry.width != getWidth() || entry.height != getHeight()))
+        return;
+    bg = entry.img;
+    mainCol = entry.mainCol;
+    squash.mainCol = mainCol;
+    gain.mainCol = mainCol;
+    meters.mainCol = mainCol;
+    scope.mainCol = mainCol;
+    subTitle.setColour(juce::Label::ColourIds::textColourId, mainCol.contrasting());
+    repaints.markDirty(*this);
 }
 
 void SusquashAudioProcessorEditor::paint (juce::Graphics& g)
 {
+    if (bg.isNull()) {
+        g.fillAll(mainCol.darker(1.f));
+        return;
+    }
     g.fillAll(mainCol.contrasting(.5f));
-    g.drawImageAt(bg, 0, 0, false);
+    // while resizing the last render gets stretched until the new one is ready
+    if (bg.getWidth() == getWidth() && bg.getHeight() == getHeight())
+        g.drawImageAt(bg, 0, 0, false);
+    else
+        g.drawImage(bg, getLocalBounds().toFloat());
 }
 
 void SusquashAudioProcessorEditor::resized()
 {
-    bg = bg.rescaled(getWidth(), getHeight(), juce::Graphics::ResamplingQuality::lowResamplingQuality);
+    if (auto entry = cache->find(seed, getWidth(), getHeight())) {
+        stopTimer();
+        setBackground(*entry);
+    }
+    else if (bg.getWidth() != getWidth() || bg.getHeight() != getHeight())
+        startTimer(RenderDelayMs);
 
     squash.setBounds(getLocalBounds());
     auto gainY = (int)(getHeight() * .8f);
     gain.setBounds(0, gainY, getWidth(), getHeight() - gainY);
 
     subTitle.setBounds(0, gain.getHeight() * 3 / 9, getWidth(), gain.getHeight());
+    meters.setBounds(getLocalBounds());
+    // inside the squash dial's ring
+    const auto dialArea = maxQuadIn(getLocalBounds().toFloat().withTrimmedTop(getHeight() * .2f));
+    scope.setBounds(dialArea.withSizeKeepingCentre(dialArea.getWidth() * .5f, dialArea.getHeight() * .25f).toNearestInt());
+    profile.setBounds(getLocalBounds().removeFromBottom(std::max(10, getHeight() / 40)));
 
     auto state = p.apvts.state;
     state.setProperty("width", getWidth(), nullptr);
@@ -2,19 +2,85 @@
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
 
+// shared by all editor instances: the threads backgrounds get rendered on
+// and the last few renders, by seed and size. the cache is only touched on
+// the message thread
+struct BackgroundCache
+{
+    static constexpr size_t MaxEntries = 4;
+
+    struct Entry
+    {
+        int seed, width, height;
+        juce::Image img;
+        juce::Colour mainCol;
+    };
+
+    BackgroundCache() :
+        pool(),
+        entries()
+    {}
+
+    // nullptr if not rendered yet
+    const Entry* find(int seed, int width, int height)
+    {
+        for (auto i = entries.begin(); i != entries.end(); ++i)
+            if (i->seed == seed && i->width == width && i->height == height) {
+                std::rotate(entries.begin(), i, i + 1);
+                return &entries.front();
+            }
+        return nullptr;
+    }
+
+    void add(const Entry& entry)
+    {
+        if (find(entry.seed, entry.width, entry.height) != nullptr)
+            entries.front() = entry;
+        else
+            entries.insert(entries.begin(), entry);
+        if (entries.size() > MaxEntries)
+            entries.pop_back();
+    }
+
+    juce::ThreadPool pool;
+protected:
+    // most recently used first
+    std::vector<Entry> entries;
+};
+
 struct SusquashAudioProcessorEditor :
-    public juce::AudioProcessorEditor
+    public juce::AudioProcessorEditor,
+    private juce::Timer
 {
+    // how long after the last resize the background gets rendered at the new size
+    static constexpr int RenderDelayMs = 150;
+
     SusquashAudioProcessorEditor (SusquashAudioProcessor&);
+    ~SusquashAudioProcessorEditor() override;
     void paint (juce::Graphics&) override;
     void resized() override;
 
     SusquashAudioProcessor& p;
+    juce::SharedResourcePointer<BackgroundCache> cache;
+    // tells the background job to give up, when the editor closes or
+    // resizes before it's done
+    std::shared_ptr<std::atomic<bool>> bgCancelled;
+    // the background is described by this, persisted in the state, and
+    // rendered at whatever size the editor has
+    int seed;
     juce::Image bg;
     juce::Colour mainCol;
+    RepaintScheduler repaints;
 
     juce::Label subTitle;
     Knob squash, gain;
+    LevelMeters meters;
+    ScopeView scope;
+    ProfileView profile;
+
+    void timerCallback() override;
+    void generateBackground(int width, int height);
+    void setBackground(BackgroundCache::Entry entry);
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SusquashAudioProcessorEditor)
 };
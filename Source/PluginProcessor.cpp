@@ -14,13 +14,55 @@ SusquashAudioProcessor::SusquashAudioProcessor()
                        ),
     apvts(*this, nullptr, "params", param::createParameters()),
     squash(apvts.getRawParameterValue(param::getID(param::ID::Squash))),
-    gain(apvts.getRawParameterValue(param::getID(param::ID::Gain)))
+    gain(apvts.getRawParameterValue(param::getID(param::ID::Gain))),
+    antiAlias(apvts.getRawParameterValue(param::getID(param::ID::AntiAlias))),
+    oversampling(apvts.getRawParameterValue(param::getID(param::ID::Oversampling))),
+    oversamplingOffline(apvts.getRawParameterValue(param::getID(param::ID::OversamplingOffline))),
+    oversamplingFilter(apvts.getRawParameterValue(param::getID(param::ID::OversamplingFilter))),
+    link(apvts.getRawParameterValue(param::getID(param::ID::Link))),
+    silenceFloor(apvts.getRawParameterValue(param::getID(param::ID::SilenceFloor))),
+    curve(apvts.getRawParameterValue(param::getID(param::ID::Curve))),
+    knee(apvts.getRawParameterValue(param::getID(param::ID::Knee))),
+    bands(apvts.getRawParameterValue(param::getID(param::ID::Bands))),
+    hysteresis(apvts.getRawParameterValue(param::getID(param::ID::Hysteresis))),
+    hold(apvts.getRawParameterValue(param::getID(param::ID::Hold))),
+    crossovers {
+        apvts.getRawParameterValue(param::getID(param::ID::Crossover1)),
+        apvts.getRawParameterValue(param::getID(param::ID::Crossover2)),
+        apvts.getRawParameterValue(param::getID(param::ID::Crossover3)) },
+    bandSquash {
+        apvts.getRawParameterValue(param::getID(param::ID::Band1Squash)),
+        apvts.getRawParameterValue(param::getID(param::ID::Band2Squash)),
+        apvts.getRawParameterValue(param::getID(param::ID::Band3Squash)),
+        apvts.getRawParameterValue(param::getID(param::ID::Band4Squash)) },
+    bandGain {
+        apvts.getRawParameterValue(param::getID(param::ID::Band1Gain)),
+        apvts.getRawParameterValue(param::getID(param::ID::Band2Gain)),
+        apvts.getRawParameterValue(param::getID(param::ID::Band3Gain)),
+        apvts.getRawParameterValue(param::getID(param::ID::Band4Gain)) },
+    binaryState(apvts),
+    arena(),
+    floatEngine(),
+    doubleEngine(),
+    meter(),
+    scope(),
+    profiler(),
+    automation(),
+    idle(false),
+    latency(0),
+    latencyChanged(false),
+    latencyReporter()
 #endif
 {
+    ++numInstances;
+    latencyReporter->add(*this);
 }
 
 SusquashAudioProcessor::~SusquashAudioProcessor()
 {
+    latencyReporter->remove(*this);
+    setIdle(false);
+    --numInstances;
 }
 
 //==============================================================================
@@ -56,9 +98,14 @@ bool SusquashAudioProcessor::isMidiEffect() const
    #endif
 }
 
+// hosts that suspend plugins on silent input go by this
 double SusquashAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    const auto sampleRate = getSampleRate();
+    if (sampleRate <= 0.)
+        return 0.;
+    const auto tail = isUsingDoublePrecision() ? doubleEngine.getTailSamples() : floatEngine.getTailSamples();
+    return tail / sampleRate;
 }
 
 int SusquashAudioProcessor::getNumPrograms()
@@ -88,6 +135,83 @@ void SusquashAudioProcessor::changeProgramName (int index, const juce::String& n
 //==============================================================================
 void SusquashAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
 {
+    profiler.prepare(sampleRate);
+    automation.reset();
+    // only the engine of the precision the host asked for gets memory
+    if (isUsingDoublePrecision()) {
+        floatEngine.release();
+        prepareEngine<double>(sampleRate, samplesPerBlock);
+    }
+    else {
+        doubleEngine.release();
+        prepareEngine<float>(sampleRate, samplesPerBlock);
+    }
+    latencyChanged.store(false);
+    setLatencySamples(latency.load());
+}
+
+template<>
+dsp::Engine<float>& SusquashAudioProcessor::getEngine<float>() noexcept { return floatEngine; }
+template<>
+dsp::Engine<double>& SusquashAudioProcessor::getEngine<double>() noexcept { return doubleEngine; }
+
+// new settings can leave the arena in pieces, the second run gets all of
+// it in one. the same settings again reuse it without allocating
+template<typename T>
+void SusquashAudioProcessor::prepareEngine(double sampleRate, int samplesPerBlock)
+{
+    auto& engine = getEngine<T>();
+    const auto numChannels = std::max(getTotalNumInputChannels(), getTotalNumOutputChannels());
+    for (auto pass = 0; pass < 2; ++pass) {
+        arena.reset();
+        engine.prepare(arena, sampleRate, samplesPerBlock, numChannels,
+            static_cast<T>(squash->load()) * static_cast<T>(.01), static_cast<T>(gain->load()));
+        if (arena.getNumBlocks() == 1)
+            break;
+    }
+    updateQuality(engine);
+}
+
+template<typename T>
+void SusquashAudioProcessor::updateQuality(dsp::Engine<T>& engine)
+{
+    const auto shape = static_cast<dsp::Curve>(static_cast<int>(curve->load() + .5f));
+    engine.setCurve(shape, static_cast<T>(knee->load()) * static_cast<T>(.01));
+    const auto numBands = static_cast<int>(bands->load() + .5f);
+    const auto thresholdDb = hysteresis->load();
+    const auto holdMs = static_cast<double>(hold->load());
+    const auto holding = thresholdDb > param::HysteresisMin || holdMs > 0.;
+    // adaa only knows sign(x) of the whole signal, so it's off here for
+    // everything else, the engine doesn't check. the soft curves alias a lot
+    // less anyway, the bands have oversampling, and the hysteresis' sign
+    // isn't a function of x alone
+    const auto order = shape == dsp::Curve::Hard && numBands < 2 && !holding ? static_cast<int>(antiAlias->load() + .5f) : 0;
+    // offline renders take whichever factor is higher
+    auto osOrder = static_cast<int>(oversampling->load() + .5f);
+    if (isNonRealtime())
+        osOrder = std::max(osOrder, static_cast<int>(oversamplingOffline->load() + .5f));
+    const auto osFilter = oversamplingFilter->load() < .5f
+        ? dsp::Engine<T>::Filter::MinPhase
+        : dsp::Engine<T>::Filter::LinearPhase;
+
+    // hosts only take whole samples, the engine rounds up
+    if (engine.setQuality(order, osOrder, osFilter)) {
+        latency.store(engine.getLatencySamples());
+        latencyChanged.store(true);
+        scope.setLatency(engine.getLatencySamples());
+    }
+
+    T crossoverHz[3], squashV[4], gainDb[4];
+    for (auto j = 0; j < 3; ++j)
+        crossoverHz[j] = static_cast<T>(crossovers[j]->load());
+    for (auto b = 0; b < 4; ++b) {
+        squashV[b] = static_cast<T>(bandSquash[b]->load()) * static_cast<T>(.01);
+        gainDb[b] = static_cast<T>(bandGain[b]->load());
+    }
+    engine.setBands(numBands, crossoverHz, squashV, gainDb);
+    engine.setHysteresis(thresholdDb > param::HysteresisMin
+        ? juce::Decibels::decibelsToGain(static_cast<T>(thresholdDb))
+        : T(0), holdMs);
 }
 
 void SusquashAudioProcessor::releaseResources()
@@ -101,12 +225,9 @@ bool SusquashAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // any channel count, as long as input and output match. channels get
+    // processed independently unless linked
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -122,20 +243,133 @@ bool SusquashAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 
 void SusquashAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 {
+    process(buffer, false);
+}
+
+void SusquashAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, false);
+}
+
+// the input delayed by the latency, crossfaded with the processed signal
+void SusquashAudioProcessor::processBlockBypassed (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, true);
+}
+
+void SusquashAudioProcessor::processBlockBypassed (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    process(buffer, true);
+}
+
+bool SusquashAudioProcessor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template<typename T>
+void SusquashAudioProcessor::process(juce::AudioBuffer<T>& buffer, bool bypassed)
+{
+    const dsp::RealtimeScope realtime;
+    const auto startTicks = profiler.start();
     juce::ScopedNoDenormals noDenormals;
     //const auto totalNumInputChannels  = getTotalNumInputChannels();
     //const auto totalNumOutputChannels = getTotalNumOutputChannels();
     //for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
     //    buffer.clear (i, 0, buffer.getNumSamples());
 
-    const auto squashV = squash->load() * .01f;
-    const auto gainV = juce::Decibels::decibelsToGain(gain->load());
+    auto& engine = getEngine<T>();
+    auto squashV = automation.get(param::ID::Squash, squash->load());
+    auto gainV = automation.get(param::ID::Gain, gain->load());
+    auto linkV = automation.get(param::ID::Link, link->load());
+
+    const auto numChannels = buffer.getNumChannels();
+    const auto numSamples = buffer.getNumSamples();
+
+    updateQuality(engine);
+    meter.startBlock(numChannels, numSamples);
+    // the input meter's pass doubles as the silence detector
+    const auto inputPeak = meter.measure(dsp::Meter::Input, buffer.getArrayOfReadPointers(), numChannels, numSamples);
+    const auto scoping = scope.isActive();
+    if (scoping)
+        scope.write(dsp::Scope::Input, buffer.getArrayOfReadPointers(), numChannels, numSamples);
+
+    const auto floorDb = silenceFloor->load();
+    const auto floorGain = floorDb <= param::SilenceFloorMin ? T(0) : juce::Decibels::decibelsToGain(static_cast<T>(floorDb));
+    const auto silent = inputPeak <= floorGain;
+
+    // the block gets split at every automation event, so each lands on its
+    // sample and starts the smoothing ramps there
+    auto isIdle = false, anyProcessed = false;
+    auto start = 0;
+    for (auto e = 0; e <= automation.size(); ++e) {
+        const auto end = e < automation.size() ? std::min(automation[e].offset, numSamples) : numSamples;
+        if (end > start) {
+            isIdle = engine.process(buffer.getArrayOfWritePointers(), numChannels, start, end - start,
+                static_cast<T>(squashV) * static_cast<T>(.01), static_cast<T>(gainV), linkV > .5f, bypassed, silent);
+            // idle output is silent. the engine left the input there, which
+            // only is below a floor above digital silence
+            if (isIdle && floorGain > T(0))
+                buffer.clear(start, end - start);
+            anyProcessed = anyProcessed || !isIdle;
+            start = end;
+        }
+        if (e == automation.size())
+            break;
+        const auto& event = automation[e];
+        switch (event.id) {
+        case param::ID::Squash:
+            squashV = event.value;
+            automation.hold(event, squash->load());
+            break;
+        case param::ID::Gain:
+            gainV = event.value;
+            automation.hold(event, gain->load());
+            break;
+        case param::ID::Link:
+            linkV = event.value;
+            automation.hold(event, link->load());
+            break;
+        default:
+            break;
+        }
+    }
+    automation.clear();
+    setIdle(isIdle);
 
-    for (auto ch = 0; ch < buffer.getNumChannels(); ++ch) {
-        auto samples = buffer.getWritePointer(ch);
-        for (auto s = 0; s < buffer.getNumSamples(); ++s)
-            samples[s] += squashV * (gainV * (samples[s] > 0 ? 1.f : samples[s] < 0 ? -1.f : 0.f) - samples[s]);
+    // a block that was idle all the way adds nothing to the output meter
+    if (anyProcessed)
+        meter.measure(dsp::Meter::Output, buffer.getArrayOfReadPointers(), numChannels, numSamples);
+    meter.publish();
+    if (scoping) {
+        scope.write(dsp::Scope::Output, buffer.getArrayOfReadPointers(), numChannels, numSamples);
+        scope.advance(numSamples);
     }
+    profiler.stop(startTicks, numSamples);
+}
+
+void SusquashAudioProcessor::reportLatency()
+{
+    if (!latencyChanged.exchange(false))
+        return;
+    const auto l = latency.load();
+    if (l != getLatencySamples())
+        setLatencySamples(l);
+}
+
+void LatencyReporter::timerCallback()
+{
+    const juce::ScopedLock sl(lock);
+    for (auto processor : processors)
+        processor->reportLatency();
+}
+
+void SusquashAudioProcessor::setIdle(bool isIdle) noexcept
+{
+    if (isIdle == idle)
+        return;
+    idle = isIdle;
+    numIdleInstances += idle ? 1 : -1;
 }
 
 //==============================================================================
@@ -152,12 +386,16 @@ juce::AudioProcessorEditor* SusquashAudioProcessor::createEditor()
 //==============================================================================
 void SusquashAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
-    std::unique_ptr<juce::XmlElement> xml(apvts.state.createXml());
-    copyXmlToBinary(*xml, destData);
+    binaryState.write(destData);
 }
 
 void SusquashAudioProcessor::setStateInformation (const void* data, int sizeInBytes)
 {
+    if (state::Binary::isBinary(data, sizeInBytes)) {
+        binaryState.read(data, sizeInBytes);
+        return;
+    }
+    // sessions saved before the binary state
     std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
     if (xmlState.get() != nullptr)
         if (xmlState->hasTagName(apvts.state.getType()))
@@ -1,6 +1,46 @@
 #pragma once
 #include <JuceHeader.h>
 #include "LiterallyEverything.h"
+#include "Engine.h"
+#include "Profiler.h"
+#include "State.h"
+#include "Automation.h"
+#include "Arena.h"
+#include "Realtime.h"
+
+struct SusquashAudioProcessor;
+
+// shared by all instances: one timer on the message thread that tells the
+// host about the latencies processBlock changed. setLatencySamples() locks
+// and allocates, so the audio thread only flags them
+struct LatencyReporter :
+    private juce::Timer
+{
+    LatencyReporter() :
+        lock(),
+        processors()
+    {
+        startTimerHz(10);
+    }
+
+    void add(SusquashAudioProcessor& processor)
+    {
+        const juce::ScopedLock sl(lock);
+        processors.push_back(&processor);
+    }
+
+    void remove(SusquashAudioProcessor& processor)
+    {
+        const juce::ScopedLock sl(lock);
+        processors.erase(std::remove(processors.begin(), processors.end(), &processor), processors.end());
+    }
+
+protected:
+    juce::CriticalSection lock;
+    std::vector<SusquashAudioProcessor*> processors;
+
+    void timerCallback() override;
+};
 
 struct SusquashAudioProcessor :
     public juce::AudioProcessor
@@ -15,6 +55,10 @@ struct SusquashAudioProcessor :
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlockBypassed (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -40,7 +84,48 @@ struct SusquashAudioProcessor :
     void setStateInformation (const void* data, int sizeInBytes) override;
 
     juce::AudioProcessorValueTreeState apvts;
-    std::atomic<float> *squash, *gain;
+    std::atomic<float> *squash, *gain, *antiAlias;
+    std::atomic<float> *oversampling, *oversamplingOffline, *oversamplingFilter, *link, *silenceFloor;
+    std::atomic<float> *curve, *knee, *bands, *hysteresis, *hold;
+    std::array<std::atomic<float>*, 3> crossovers;
+    std::array<std::atomic<float>*, 4> bandSquash, bandGain;
+    // saves and loads the state without going through xml
+    state::Binary binaryState;
+    // all the memory processBlock works in, sized in prepareToPlay
+    dsp::Arena arena;
+    dsp::Engine<float> floatEngine;
+    dsp::Engine<double> doubleEngine;
+    // input and output levels for the editor
+    dsp::Meter meter;
+    // input and output samples, while the editor shows them
+    dsp::Scope scope;
+    // processBlock's time against the real time budget
+    dsp::Profiler profiler;
+    // sample accurate parameter changes for the next block
+    dsp::Automation automation;
+    // the input has been below the silence floor for longer than the tail
+    bool idle;
+    // the engine's latency as of the last quality change, and whether the
+    // host has yet to hear about it. prepareToPlay and the LatencyReporter
+    // tell it
+    std::atomic<int> latency;
+    std::atomic<bool> latencyChanged;
+    juce::SharedResourcePointer<LatencyReporter> latencyReporter;
+
+    // of all instances in this process, e.g. to see what silence saves
+    static int getNumInstances() noexcept { return numInstances.load(); }
+    static int getNumIdleInstances() noexcept { return numIdleInstances.load(); }
+
+    template<typename T> dsp::Engine<T>& getEngine() noexcept;
+    template<typename T> void prepareEngine(double sampleRate, int samplesPerBlock);
+    // applies the curve, hysteresis, band, anti alias and oversampling parameters and reports the latency
+    template<typename T> void updateQuality(dsp::Engine<T>& engine);
+    template<typename T> void process(juce::AudioBuffer<T>& buffer, bool bypassed);
+    void setIdle(bool isIdle) noexcept;
+    // message thread. tells the host if processBlock changed the latency
+    void reportLatency();
+
+    static inline std::atomic<int> numInstances { 0 }, numIdleInstances { 0 };
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SusquashAudioProcessor)
 };
@@ -0,0 +1,139 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace dsp
+{
+    // processBlock's time against the block's real time budget, per
+    // instance. load 1 uses the whole budget. the audio thread is the only
+    // writer and gets by with relaxed loads and stores, other threads read
+    // a snapshot that may lag a block behind
+    struct Profiler
+    {
+        // log spaced load bins from MinLoad to MinLoad * 10^NumDecades
+        static constexpr double MinLoad = 1e-4;
+        static constexpr int BinsPerDecade = 20, NumDecades = 6, NumBins = BinsPerDecade * NumDecades;
+
+        struct Snapshot
+        {
+            juce::uint64 numBlocks, numOverruns;
+            // in budgets, the percentiles are as fine as the bins
+            double min, median, p99, max;
+
+            juce::var toJSON() const
+            {
+                juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+                obj->setProperty("blocks", static_cast<juce::int64>(numBlocks));
+                obj->setProperty("overruns", static_cast<juce::int64>(numOverruns));
+                obj->setProperty("min", min);
+                obj->setProperty("median", median);
+                obj->setProperty("p99", p99);
+                obj->setProperty("max", max);
+                return juce::var(obj.get());
+            }
+        };
+
+        Profiler() :
+            bins(),
+            numBlocks(0), numOverruns(0),
+            minLoad(0.), maxLoad(0.),
+            sampleRate(44100.),
+            resetRequested(false)
+        {
+            for (auto& b : bins)
+                b.store(0, std::memory_order_relaxed);
+        }
+
+        void prepare(double _sampleRate) noexcept { sampleRate = _sampleRate; }
+
+        // audio thread, around processBlock
+        juce::int64 start() const noexcept { return juce::Time::getHighResolutionTicks(); }
+
+        void stop(juce::int64 startTicks, int numSamples) noexcept
+        {
+            const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - startTicks);
+            if (numSamples <= 0)
+                return;
+            if (resetRequested.load(std::memory_order_relaxed)) {
+                resetRequested.store(false, std::memory_order_relaxed);
+                clear();
+            }
+            const auto load = seconds * sampleRate / numSamples;
+            const auto n = numBlocks.load(std::memory_order_relaxed);
+
+            auto& bin = bins[getBin(load)];
+            bin.store(bin.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (load > 1.)
+                numOverruns.store(numOverruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            if (n == 0 || load < minLoad.load(std::memory_order_relaxed))
+                minLoad.store(load, std::memory_order_relaxed);
+            if (n == 0 || load > maxLoad.load(std::memory_order_relaxed))
+                maxLoad.store(load, std::memory_order_relaxed);
+            numBlocks.store(n + 1, std::memory_order_release);
+        }
+
+        // any thread. the audio thread starts over with its next block
+        void reset() noexcept { resetRequested.store(true, std::memory_order_relaxed); }
+
+        // any thread
+        Snapshot getSnapshot() const noexcept
+        {
+            Snapshot s;
+            s.numBlocks = numBlocks.load(std::memory_order_acquire);
+            s.numOverruns = numOverruns.load(std::memory_order_relaxed);
+            s.min = minLoad.load(std::memory_order_relaxed);
+            s.max = maxLoad.load(std::memory_order_relaxed);
+
+            juce::uint64 counts[NumBins], total = 0;
+            for (auto i = 0; i < NumBins; ++i)
+                total += counts[i] = bins[i].load(std::memory_order_relaxed);
+            // bin centres can lie outside what was measured
+            s.median = juce::jlimit(s.min, s.max, getPercentile(counts, total, .5));
+            s.p99 = juce::jlimit(s.min, s.max, getPercentile(counts, total, .99));
+            return s;
+        }
+
+    protected:
+        std::atomic<juce::uint64> bins[NumBins];
+        std::atomic<juce::uint64> numBlocks, numOverruns;
+        std::atomic<double> minLoad, maxLoad;
+        // set in prepareToPlay, read on the audio thread
+        double sampleRate;
+        std::atomic<bool> resetRequested;
+
+        static int getBin(double load) noexcept
+        {
+            if (load <= MinLoad)
+                return 0;
+            const auto bin = static_cast<int>(std::log10(load / MinLoad) * BinsPerDecade);
+            return std::min(bin, NumBins - 1);
+        }
+
+        // the geometric centre of bin i
+        static double getLoad(int i) noexcept
+        {
+            return MinLoad * std::pow(10., (i + .5) / BinsPerDecade);
+        }
+
+        static double getPercentile(const juce::uint64* counts, juce::uint64 total, double p) noexcept
+        {
+            if (total == 0)
+                return 0.;
+            const auto rank = static_cast<juce::uint64>(std::ceil(p * static_cast<double>(total)));
+            juce::uint64 sum = 0;
+            for (auto i = 0; i < NumBins; ++i) {
+                sum += counts[i];
+                if (sum >= rank)
+                    return getLoad(i);
+            }
+            return getLoad(NumBins - 1);
+        }
+
+        void clear() noexcept
+        {
+            for (auto& b : bins)
+                b.store(0, std::memory_order_relaxed);
+            numOverruns.store(0, std::memory_order_relaxed);
+            numBlocks.store(0, std::memory_order_relaxed);
+        }
+    };
+}
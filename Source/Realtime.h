@@ -0,0 +1,32 @@
+#pragma once
+
+namespace dsp
+{
+    // processBlock's contract: no heap, no locks, no system calls. builds
+    // with SUSQUASH_RT_CHECK mark the audio thread while it's inside, so
+    // the hooks of Tools/RealtimeCheck can trap whatever breaks it. in
+    // every other build this is empty. no juce in here, the hooks include
+    // it before there's anything to initialise juce with
+    struct RealtimeScope
+    {
+       #if SUSQUASH_RT_CHECK
+        // false lifts the contract again, e.g. while reporting a violation
+        RealtimeScope(bool realtime = true) noexcept :
+            previous(depth)
+        {
+            depth = realtime ? previous + 1 : 0;
+        }
+        ~RealtimeScope() { depth = previous; }
+
+        static bool isRealtime() noexcept { return depth > 0; }
+
+    protected:
+        int previous;
+        static inline thread_local int depth = 0;
+       #else
+        RealtimeScope(bool = true) noexcept {}
+
+        static constexpr bool isRealtime() noexcept { return false; }
+       #endif
+    };
+}
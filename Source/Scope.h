@@ -0,0 +1,79 @@
+#pragma once
+#include <JuceHeader.h>
+
+namespace dsp
+{
+    // the latest input and output samples, mixed to mono, for the editor's
+    // scope. only written while an editor shows it, otherwise it costs the
+    // audio thread one relaxed load per block. the audio thread publishes
+    // its write position once per block and the editor copies what it needs
+    // from behind it. the ring is a lot longer than what the editor reads,
+    // so the audio thread rarely gets there first, and if it does the trace
+    // is off for a frame
+    struct Scope
+    {
+        static constexpr int Size = 1 << 13, Mask = Size - 1;
+        enum Signal { Input, Output, NumSignals };
+
+        Scope() :
+            ring(static_cast<size_t>(NumSignals * Size), 0.f),
+            pos(0),
+            writePos(0),
+            latency(0),
+            active(false)
+        {}
+
+        void setActive(bool a) noexcept { active.store(a, std::memory_order_relaxed); }
+        bool isActive() const noexcept { return active.load(std::memory_order_relaxed); }
+
+        // in whole samples. the editor delays the input by it, so it lines up
+        // with the output
+        void setLatency(int l) noexcept { latency.store(l, std::memory_order_relaxed); }
+
+        // audio thread, the input before and the output after processing,
+        // then advance()
+        template<typename T>
+        void write(Signal signal, const T* const* channels, int numChannels, int numSamples) noexcept
+        {
+            if (numChannels == 0)
+                return;
+            auto buf = ring.data() + signal * Size;
+            const auto gain = T(1) / static_cast<T>(numChannels);
+            for (auto s = 0; s < numSamples; ++s) {
+                auto x = channels[0][s];
+                for (auto ch = 1; ch < numChannels; ++ch)
+                    x += channels[ch][s];
+                buf[(pos + static_cast<juce::uint32>(s)) & Mask] = static_cast<float>(x * gain);
+            }
+        }
+
+        void advance(int numSamples) noexcept
+        {
+            pos += static_cast<juce::uint32>(numSamples);
+            writePos.store(pos, std::memory_order_release);
+        }
+
+        // counts up with every sample written, so it tells new data apart
+        juce::uint32 getWritePos() const noexcept { return writePos.load(std::memory_order_acquire); }
+
+        // message thread. the numSamples samples before end. numSamples
+        // plus the latency should stay well below Size
+        void read(Signal signal, juce::uint32 end, float* dest, int numSamples) const noexcept
+        {
+            if (signal == Input)
+                end -= static_cast<juce::uint32>(latency.load(std::memory_order_relaxed));
+            const auto buf = ring.data() + signal * Size;
+            const auto start = end - static_cast<juce::uint32>(numSamples);
+            for (auto s = 0; s < numSamples; ++s)
+                dest[s] = buf[(start + static_cast<juce::uint32>(s)) & Mask];
+        }
+
+    protected:
+        std::vector<float> ring;
+        // audio thread only
+        juce::uint32 pos;
+        std::atomic<juce::uint32> writePos;
+        std::atomic<int> latency;
+        std::atomic<bool> active;
+    };
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <JuceHeader.h>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+#endif
+
+// kernels are written once against the vector types in SimdVec.h and
+// compiled once per instruction set. these macros open/close a region
+// in which the compiler may emit that instruction set. contraction into
+// fma stays off, avx512 implies fma and would change the rounding.
+#if JUCE_INTEL && JUCE_CLANG
+ #define SUSQUASH_BEGIN_TARGET(isa) _Pragma(isa) _Pragma("clang fp contract(off)")
+ #define SUSQUASH_BEGIN_SSE2 SUSQUASH_BEGIN_TARGET("clang attribute push (__attribute__((target(\"sse2\"))), apply_to = function)")
+ #define SUSQUASH_BEGIN_AVX2 SUSQUASH_BEGIN_TARGET("clang attribute push (__attribute__((target(\"avx2\"))), apply_to = function)")
+ #define SUSQUASH_BEGIN_AVX512 SUSQUASH_BEGIN_TARGET("clang attribute push (__attribute__((target(\"avx512f\"))), apply_to = function)")
+ #define SUSQUASH_END_TARGET _Pragma("clang attribute pop") _Pragma("clang fp contract(on)")
+#elif JUCE_INTEL && JUCE_GCC
+ #define SUSQUASH_BEGIN_TARGET(isa) _Pragma("GCC push_options") _Pragma(isa) _Pragma("GCC optimize(\"fp-contract=off\")") \
+    _Pragma("GCC diagnostic push") _Pragma("GCC diagnostic ignored \"-Wmaybe-uninitialized\"")
+ #define SUSQUASH_BEGIN_SSE2 SUSQUASH_BEGIN_TARGET("GCC target(\"sse2\")")
+ #define SUSQUASH_BEGIN_AVX2 SUSQUASH_BEGIN_TARGET("GCC target(\"avx2\")")
+ #define SUSQUASH_BEGIN_AVX512 SUSQUASH_BEGIN_TARGET("GCC target(\"avx512f\")")
+ #define SUSQUASH_END_TARGET _Pragma("GCC diagnostic pop") _Pragma("GCC pop_options")
+#else // msvc emits any intrinsic without extra flags
+ #define SUSQUASH_BEGIN_SSE2
+ #define SUSQUASH_BEGIN_AVX2
+ #define SUSQUASH_BEGIN_AVX512
+ #define SUSQUASH_END_TARGET
+#endif
+
+namespace dsp
+{
+    enum class ISA { Scalar, SSE2, AVX2, AVX512, NumISAs };
+
+    inline juce::String toString(ISA isa)
+    {
+        switch (isa)
+        {
+        case ISA::Scalar: return "scalar";
+        case ISA::SSE2: return "sse2";
+        case ISA::AVX2: return "avx2";
+        case ISA::AVX512: return "avx512";
+        default: return "";
+        }
+    }
+
+    inline bool isSupported(ISA isa) noexcept
+    {
+       #if JUCE_INTEL
+        switch (isa)
+        {
+        case ISA::Scalar: return true;
+        case ISA::SSE2: return juce::SystemStats::hasSSE2();
+        case ISA::AVX2: return juce::SystemStats::hasAVX2();
+        case ISA::AVX512: return juce::SystemStats::hasAVX512F();
+        default: return false;
+        }
+       #else
+        return isa == ISA::Scalar;
+       #endif
+    }
+
+    // the widest instruction set this cpu can run. evaluated once per process
+    inline ISA getISA() noexcept
+    {
+        static const ISA isa = []()
+        {
+            for (auto i = static_cast<int>(ISA::NumISAs) - 1; i > 0; --i)
+                if (isSupported(static_cast<ISA>(i)))
+                    return static_cast<ISA>(i);
+            return ISA::Scalar;
+        }();
+        return isa;
+    }
+}
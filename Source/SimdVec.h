@@ -0,0 +1,384 @@
+#pragma once
+#include "Simd.h"
+
+// one vector type per instruction set, all with the same static interface,
+// so a kernel template instantiated with any of them compiles to that isa.
+// masks are whatever the isa compares into and only go back into select(),
+// or to and from bits, lane i in bit i.
+// VecF holds floats, VecD doubles, so a register holds half as many of them.
+// the double pow2i adds n to 2^52 + 1023, which leaves n + 1023 in the low
+// mantissa bits, and shifts that into the exponent. sse2 has no 64 bit
+// integer conversion, this way all isas share the trick.
+// Vec4F and Vec4D are 4 lanes on every isa, for kernels that pack 4 of
+// something rather than 4 samples.
+
+namespace dsp
+{
+    // two registers of V as one, with twice the lanes
+    template<class V>
+    struct Twice
+    {
+        using Type = typename V::Type;
+        struct Reg { typename V::Reg lo, hi; };
+        struct Mask { typename V::Mask lo, hi; };
+        static constexpr int size = 2 * V::size;
+
+        static Reg load(const Type* p) noexcept { return { V::load(p), V::load(p + V::size) }; }
+        static void store(Type* p, Reg a) noexcept { V::store(p, a.lo); V::store(p + V::size, a.hi); }
+        static Reg set1(Type v) noexcept { return { V::set1(v), V::set1(v) }; }
+        static Reg add(Reg a, Reg b) noexcept { return { V::add(a.lo, b.lo), V::add(a.hi, b.hi) }; }
+        static Reg sub(Reg a, Reg b) noexcept { return { V::sub(a.lo, b.lo), V::sub(a.hi, b.hi) }; }
+        static Reg mul(Reg a, Reg b) noexcept { return { V::mul(a.lo, b.lo), V::mul(a.hi, b.hi) }; }
+        static Reg div(Reg a, Reg b) noexcept { return { V::div(a.lo, b.lo), V::div(a.hi, b.hi) }; }
+        static Reg abs(Reg a) noexcept { return { V::abs(a.lo), V::abs(a.hi) }; }
+        static Reg min(Reg a, Reg b) noexcept { return { V::min(a.lo, b.lo), V::min(a.hi, b.hi) }; }
+        static Reg max(Reg a, Reg b) noexcept { return { V::max(a.lo, b.lo), V::max(a.hi, b.hi) }; }
+        static Mask gt(Reg a, Reg b) noexcept { return { V::gt(a.lo, b.lo), V::gt(a.hi, b.hi) }; }
+        static Mask lt(Reg a, Reg b) noexcept { return { V::lt(a.lo, b.lo), V::lt(a.hi, b.hi) }; }
+        static Reg select(Mask m, Reg a, Reg b) noexcept { return { V::select(m.lo, a.lo, b.lo), V::select(m.hi, a.hi, b.hi) }; }
+        static Mask fromBits(unsigned bits) noexcept { return { V::fromBits(bits), V::fromBits(bits >> V::size) }; }
+        static unsigned toBits(Mask m) noexcept { return V::toBits(m.lo) | V::toBits(m.hi) << V::size; }
+        static Reg sign(Reg a) noexcept { return { V::sign(a.lo), V::sign(a.hi) }; }
+        static Reg round(Reg a) noexcept { return { V::round(a.lo), V::round(a.hi) }; }
+        static Reg pow2i(Reg n) noexcept { return { V::pow2i(n.lo), V::pow2i(n.hi) }; }
+    };
+
+    namespace scalar
+    {
+        struct VecF
+        {
+            using Type = float;
+            using Reg = float;
+            using Mask = bool;
+            static constexpr int size = 1;
+
+            static Reg load(const Type* p) noexcept { return *p; }
+            static void store(Type* p, Reg a) noexcept { *p = a; }
+            static Reg set1(Type v) noexcept { return v; }
+            static Reg add(Reg a, Reg b) noexcept { return a + b; }
+            static Reg sub(Reg a, Reg b) noexcept { return a - b; }
+            static Reg mul(Reg a, Reg b) noexcept { return a * b; }
+            static Reg div(Reg a, Reg b) noexcept { return a / b; }
+            static Reg abs(Reg a) noexcept { return std::abs(a); }
+            static Reg min(Reg a, Reg b) noexcept { return a < b ? a : b; }
+            static Reg max(Reg a, Reg b) noexcept { return a > b ? a : b; }
+            static Mask gt(Reg a, Reg b) noexcept { return a > b; }
+            static Mask lt(Reg a, Reg b) noexcept { return a < b; }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return m ? a : b; }
+            static Mask fromBits(unsigned bits) noexcept { return (bits & 1) != 0; }
+            static unsigned toBits(Mask m) noexcept { return m ? 1 : 0; }
+            static Reg sign(Reg a) noexcept { return a > 0.f ? 1.f : a < 0.f ? -1.f : 0.f; }
+            static Reg round(Reg a) noexcept { return std::nearbyint(a); }
+            // 2^n for integral n in the normal range
+            static Reg pow2i(Reg n) noexcept
+            {
+                const auto bits = (static_cast<int>(n) + 127) << 23;
+                Reg y;
+                std::memcpy(&y, &bits, sizeof(y));
+                return y;
+            }
+        };
+
+        struct VecD
+        {
+            using Type = double;
+            using Reg = double;
+            using Mask = bool;
+            static constexpr int size = 1;
+
+            static Reg load(const Type* p) noexcept { return *p; }
+            static void store(Type* p, Reg a) noexcept { *p = a; }
+            static Reg set1(Type v) noexcept { return v; }
+            static Reg add(Reg a, Reg b) noexcept { return a + b; }
+            static Reg sub(Reg a, Reg b) noexcept { return a - b; }
+            static Reg mul(Reg a, Reg b) noexcept { return a * b; }
+            static Reg div(Reg a, Reg b) noexcept { return a / b; }
+            static Reg abs(Reg a) noexcept { return std::abs(a); }
+            static Reg min(Reg a, Reg b) noexcept { return a < b ? a : b; }
+            static Reg max(Reg a, Reg b) noexcept { return a > b ? a : b; }
+            static Mask gt(Reg a, Reg b) noexcept { return a > b; }
+            static Mask lt(Reg a, Reg b) noexcept { return a < b; }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return m ? a : b; }
+            static Mask fromBits(unsigned bits) noexcept { return (bits & 1) != 0; }
+            static unsigned toBits(Mask m) noexcept { return m ? 1 : 0; }
+            static Reg sign(Reg a) noexcept { return a > 0. ? 1. : a < 0. ? -1. : 0.; }
+            static Reg round(Reg a) noexcept { return std::nearbyint(a); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                const auto bits = static_cast<juce::int64>(static_cast<int>(n) + 1023) << 52;
+                Reg y;
+                std::memcpy(&y, &bits, sizeof(y));
+                return y;
+            }
+        };
+
+        using Vec4F = Twice<Twice<VecF>>;
+        using Vec4D = Twice<Twice<VecD>>;
+    }
+}
+
+#if JUCE_INTEL
+SUSQUASH_BEGIN_SSE2
+namespace dsp
+{
+    namespace sse2
+    {
+        struct VecF
+        {
+            using Type = float;
+            using Reg = __m128;
+            using Mask = __m128;
+            static constexpr int size = 4;
+
+            static Reg load(const Type* p) noexcept { return _mm_loadu_ps(p); }
+            static void store(Type* p, Reg a) noexcept { _mm_storeu_ps(p, a); }
+            static Reg set1(Type v) noexcept { return _mm_set1_ps(v); }
+            static Reg add(Reg a, Reg b) noexcept { return _mm_add_ps(a, b); }
+            static Reg sub(Reg a, Reg b) noexcept { return _mm_sub_ps(a, b); }
+            static Reg mul(Reg a, Reg b) noexcept { return _mm_mul_ps(a, b); }
+            static Reg div(Reg a, Reg b) noexcept { return _mm_div_ps(a, b); }
+            static Reg abs(Reg a) noexcept { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+            static Reg min(Reg a, Reg b) noexcept { return _mm_min_ps(a, b); }
+            static Reg max(Reg a, Reg b) noexcept { return _mm_max_ps(a, b); }
+            static Mask gt(Reg a, Reg b) noexcept { return _mm_cmpgt_ps(a, b); }
+            static Mask lt(Reg a, Reg b) noexcept { return _mm_cmplt_ps(a, b); }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+            static Mask fromBits(unsigned bits) noexcept
+            {
+                const auto lanes = _mm_setr_epi32(1, 2, 4, 8);
+                return _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), lanes), lanes));
+            }
+            static unsigned toBits(Mask m) noexcept { return static_cast<unsigned>(_mm_movemask_ps(m)); }
+            static Reg sign(Reg a) noexcept
+            {
+                const auto zero = _mm_setzero_ps();
+                return _mm_or_ps(
+                    _mm_and_ps(_mm_cmpgt_ps(a, zero), _mm_set1_ps(1.f)),
+                    _mm_and_ps(_mm_cmplt_ps(a, zero), _mm_set1_ps(-1.f)));
+            }
+            static Reg round(Reg a) noexcept { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_cvtps_epi32(n), _mm_set1_epi32(127)), 23));
+            }
+        };
+
+        struct VecD
+        {
+            using Type = double;
+            using Reg = __m128d;
+            using Mask = __m128d;
+            static constexpr int size = 2;
+
+            static Reg load(const Type* p) noexcept { return _mm_loadu_pd(p); }
+            static void store(Type* p, Reg a) noexcept { _mm_storeu_pd(p, a); }
+            static Reg set1(Type v) noexcept { return _mm_set1_pd(v); }
+            static Reg add(Reg a, Reg b) noexcept { return _mm_add_pd(a, b); }
+            static Reg sub(Reg a, Reg b) noexcept { return _mm_sub_pd(a, b); }
+            static Reg mul(Reg a, Reg b) noexcept { return _mm_mul_pd(a, b); }
+            static Reg div(Reg a, Reg b) noexcept { return _mm_div_pd(a, b); }
+            static Reg abs(Reg a) noexcept { return _mm_andnot_pd(_mm_set1_pd(-0.), a); }
+            static Reg min(Reg a, Reg b) noexcept { return _mm_min_pd(a, b); }
+            static Reg max(Reg a, Reg b) noexcept { return _mm_max_pd(a, b); }
+            static Mask gt(Reg a, Reg b) noexcept { return _mm_cmpgt_pd(a, b); }
+            static Mask lt(Reg a, Reg b) noexcept { return _mm_cmplt_pd(a, b); }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b)); }
+            // no 64 bit compare in sse2, both halves of a lane test the same bit
+            static Mask fromBits(unsigned bits) noexcept
+            {
+                const auto lanes = _mm_setr_epi32(1, 1, 2, 2);
+                return _mm_castsi128_pd(_mm_cmpeq_epi32(_mm_and_si128(_mm_set1_epi32(static_cast<int>(bits)), lanes), lanes));
+            }
+            static unsigned toBits(Mask m) noexcept { return static_cast<unsigned>(_mm_movemask_pd(m)); }
+            static Reg sign(Reg a) noexcept
+            {
+                const auto zero = _mm_setzero_pd();
+                return _mm_or_pd(
+                    _mm_and_pd(_mm_cmpgt_pd(a, zero), _mm_set1_pd(1.)),
+                    _mm_and_pd(_mm_cmplt_pd(a, zero), _mm_set1_pd(-1.)));
+            }
+            static Reg round(Reg a) noexcept { return _mm_cvtepi32_pd(_mm_cvtpd_epi32(a)); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(_mm_add_pd(n, _mm_set1_pd(4503599627371519.))), 52));
+            }
+        };
+
+        using Vec4F = VecF;
+        using Vec4D = Twice<VecD>;
+    }
+}
+SUSQUASH_END_TARGET
+
+SUSQUASH_BEGIN_AVX2
+namespace dsp
+{
+    namespace avx2
+    {
+        struct VecF
+        {
+            using Type = float;
+            using Reg = __m256;
+            using Mask = __m256;
+            static constexpr int size = 8;
+
+            static Reg load(const Type* p) noexcept { return _mm256_loadu_ps(p); }
+            static void store(Type* p, Reg a) noexcept { _mm256_storeu_ps(p, a); }
+            static Reg set1(Type v) noexcept { return _mm256_set1_ps(v); }
+            static Reg add(Reg a, Reg b) noexcept { return _mm256_add_ps(a, b); }
+            static Reg sub(Reg a, Reg b) noexcept { return _mm256_sub_ps(a, b); }
+            static Reg mul(Reg a, Reg b) noexcept { return _mm256_mul_ps(a, b); }
+            static Reg div(Reg a, Reg b) noexcept { return _mm256_div_ps(a, b); }
+            static Reg abs(Reg a) noexcept { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+            static Reg min(Reg a, Reg b) noexcept { return _mm256_min_ps(a, b); }
+            static Reg max(Reg a, Reg b) noexcept { return _mm256_max_ps(a, b); }
+            static Mask gt(Reg a, Reg b) noexcept { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+            static Mask lt(Reg a, Reg b) noexcept { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return _mm256_blendv_ps(b, a, m); }
+            static Mask fromBits(unsigned bits) noexcept
+            {
+                const auto lanes = _mm256_setr_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+                return _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(_mm256_set1_epi32(static_cast<int>(bits)), lanes), lanes));
+            }
+            static unsigned toBits(Mask m) noexcept { return static_cast<unsigned>(_mm256_movemask_ps(m)); }
+            static Reg sign(Reg a) noexcept
+            {
+                const auto zero = _mm256_setzero_ps();
+                return _mm256_or_ps(
+                    _mm256_and_ps(_mm256_cmp_ps(a, zero, _CMP_GT_OQ), _mm256_set1_ps(1.f)),
+                    _mm256_and_ps(_mm256_cmp_ps(a, zero, _CMP_LT_OQ), _mm256_set1_ps(-1.f)));
+            }
+            static Reg round(Reg a) noexcept { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23));
+            }
+        };
+
+        struct VecD
+        {
+            using Type = double;
+            using Reg = __m256d;
+            using Mask = __m256d;
+            static constexpr int size = 4;
+
+            static Reg load(const Type* p) noexcept { return _mm256_loadu_pd(p); }
+            static void store(Type* p, Reg a) noexcept { _mm256_storeu_pd(p, a); }
+            static Reg set1(Type v) noexcept { return _mm256_set1_pd(v); }
+            static Reg add(Reg a, Reg b) noexcept { return _mm256_add_pd(a, b); }
+            static Reg sub(Reg a, Reg b) noexcept { return _mm256_sub_pd(a, b); }
+            static Reg mul(Reg a, Reg b) noexcept { return _mm256_mul_pd(a, b); }
+            static Reg div(Reg a, Reg b) noexcept { return _mm256_div_pd(a, b); }
+            static Reg abs(Reg a) noexcept { return _mm256_andnot_pd(_mm256_set1_pd(-0.), a); }
+            static Reg min(Reg a, Reg b) noexcept { return _mm256_min_pd(a, b); }
+            static Reg max(Reg a, Reg b) noexcept { return _mm256_max_pd(a, b); }
+            static Mask gt(Reg a, Reg b) noexcept { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+            static Mask lt(Reg a, Reg b) noexcept { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return _mm256_blendv_pd(b, a, m); }
+            static Mask fromBits(unsigned bits) noexcept
+            {
+                const auto lanes = _mm256_setr_epi64x(1, 2, 4, 8);
+                return _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(_mm256_set1_epi64x(bits), lanes), lanes));
+            }
+            static unsigned toBits(Mask m) noexcept { return static_cast<unsigned>(_mm256_movemask_pd(m)); }
+            static Reg sign(Reg a) noexcept
+            {
+                const auto zero = _mm256_setzero_pd();
+                return _mm256_or_pd(
+                    _mm256_and_pd(_mm256_cmp_pd(a, zero, _CMP_GT_OQ), _mm256_set1_pd(1.)),
+                    _mm256_and_pd(_mm256_cmp_pd(a, zero, _CMP_LT_OQ), _mm256_set1_pd(-1.)));
+            }
+            static Reg round(Reg a) noexcept { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(n, _mm256_set1_pd(4503599627371519.))), 52));
+            }
+        };
+
+        using Vec4F = sse2::VecF;
+        using Vec4D = VecD;
+    }
+}
+SUSQUASH_END_TARGET
+
+SUSQUASH_BEGIN_AVX512
+namespace dsp
+{
+    namespace avx512
+    {
+        struct VecF
+        {
+            using Type = float;
+            using Reg = __m512;
+            using Mask = __mmask16;
+            static constexpr int size = 16;
+
+            static Reg load(const Type* p) noexcept { return _mm512_loadu_ps(p); }
+            static void store(Type* p, Reg a) noexcept { _mm512_storeu_ps(p, a); }
+            static Reg set1(Type v) noexcept { return _mm512_set1_ps(v); }
+            static Reg add(Reg a, Reg b) noexcept { return _mm512_add_ps(a, b); }
+            static Reg sub(Reg a, Reg b) noexcept { return _mm512_sub_ps(a, b); }
+            static Reg mul(Reg a, Reg b) noexcept { return _mm512_mul_ps(a, b); }
+            static Reg div(Reg a, Reg b) noexcept { return _mm512_div_ps(a, b); }
+            static Reg abs(Reg a) noexcept { return _mm512_abs_ps(a); }
+            static Reg min(Reg a, Reg b) noexcept { return _mm512_min_ps(a, b); }
+            static Reg max(Reg a, Reg b) noexcept { return _mm512_max_ps(a, b); }
+            static Mask gt(Reg a, Reg b) noexcept { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+            static Mask lt(Reg a, Reg b) noexcept { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return _mm512_mask_blend_ps(m, b, a); }
+            static Mask fromBits(unsigned bits) noexcept { return static_cast<Mask>(bits); }
+            static unsigned toBits(Mask m) noexcept { return m; }
+            static Reg sign(Reg a) noexcept
+            {
+                const auto zero = _mm512_setzero_ps();
+                const auto pos = _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(a, zero, _CMP_GT_OQ), _mm512_set1_ps(1.f));
+                return _mm512_mask_mov_ps(pos, _mm512_cmp_ps_mask(a, zero, _CMP_LT_OQ), _mm512_set1_ps(-1.f));
+            }
+            static Reg round(Reg a) noexcept { return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(_mm512_cvtps_epi32(n), _mm512_set1_epi32(127)), 23));
+            }
+        };
+
+        struct VecD
+        {
+            using Type = double;
+            using Reg = __m512d;
+            using Mask = __mmask8;
+            static constexpr int size = 8;
+
+            static Reg load(const Type* p) noexcept { return _mm512_loadu_pd(p); }
+            static void store(Type* p, Reg a) noexcept { _mm512_storeu_pd(p, a); }
+            static Reg set1(Type v) noexcept { return _mm512_set1_pd(v); }
+            static Reg add(Reg a, Reg b) noexcept { return _mm512_add_pd(a, b); }
+            static Reg sub(Reg a, Reg b) noexcept { return _mm512_sub_pd(a, b); }
+            static Reg mul(Reg a, Reg b) noexcept { return _mm512_mul_pd(a, b); }
+            static Reg div(Reg a, Reg b) noexcept { return _mm512_div_pd(a, b); }
+            static Reg abs(Reg a) noexcept { return _mm512_abs_pd(a); }
+            static Reg min(Reg a, Reg b) noexcept { return _mm512_min_pd(a, b); }
+            static Reg max(Reg a, Reg b) noexcept { return _mm512_max_pd(a, b); }
+            static Mask gt(Reg a, Reg b) noexcept { return _mm512_cmp_pd_mask(a, b, _CMP_GT_OQ); }
+            static Mask lt(Reg a, Reg b) noexcept { return _mm512_cmp_pd_mask(a, b, _CMP_LT_OQ); }
+            static Reg select(Mask m, Reg a, Reg b) noexcept { return _mm512_mask_blend_pd(m, b, a); }
+            static Mask fromBits(unsigned bits) noexcept { return static_cast<Mask>(bits); }
+            static unsigned toBits(Mask m) noexcept { return m; }
+            static Reg sign(Reg a) noexcept
+            {
+                const auto zero = _mm512_setzero_pd();
+                const auto pos = _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(a, zero, _CMP_GT_OQ), _mm512_set1_pd(1.));
+                return _mm512_mask_mov_pd(pos, _mm512_cmp_pd_mask(a, zero, _CMP_LT_OQ), _mm512_set1_pd(-1.));
+            }
+            static Reg round(Reg a) noexcept { return _mm512_roundscale_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+            static Reg pow2i(Reg n) noexcept
+            {
+                return _mm512_castsi512_pd(_mm512_slli_epi64(_mm512_castpd_si512(_mm512_add_pd(n, _mm512_set1_pd(4503599627371519.))), 52));
+            }
+        };
+
+        using Vec4F = sse2::VecF;
+        using Vec4D = avx2::VecD;
+    }
+}
+SUSQUASH_END_TARGET
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+#include "Arena.h"
+
+namespace dsp
+{
+    // linear ramp towards the latest parameter value. the target is read
+    // once per block and the ramp rendered into a buffer taken from the
+    // arena in prepare(). while the value rests nothing is rendered at all.
+    template<typename T>
+    struct Smooth
+    {
+        Smooth() :
+            buf(),
+            value(T(0)), dest(T(0)), inc(T(0)),
+            rampLength(1), remaining(0)
+        {}
+
+        void prepare(Arena& arena, int maxBlockSize)
+        {
+            buf = arena.take<T>(static_cast<size_t>(maxBlockSize));
+            remaining = 0;
+        }
+
+        // doesn't allocate. a running ramp jumps to its destination
+        void setLength(double sampleRate, double lengthMs) noexcept
+        {
+            rampLength = std::max(1, static_cast<int>(sampleRate * lengthMs * .001));
+            value = dest;
+            remaining = 0;
+        }
+
+        void reset(T v) noexcept
+        {
+            value = dest = v;
+            remaining = 0;
+        }
+
+        // true if the value moves during the next numSamples samples.
+        // in that case data() holds one value per sample
+        bool operator()(T target, int numSamples) noexcept
+        {
+            if (target != dest) {
+                dest = target;
+                inc = (dest - value) / static_cast<T>(rampLength);
+                remaining = rampLength;
+            }
+            if (remaining == 0 || numSamples == 0)
+                return false;
+
+            const auto rampLen = std::min(remaining, numSamples);
+            const auto start = value;
+            for (auto s = 0; s < rampLen; ++s)
+                buf[s] = start + inc * static_cast<T>(s + 1);
+            for (auto s = rampLen; s < numSamples; ++s)
+                buf[s] = dest;
+
+            remaining -= rampLen;
+            if (remaining == 0)
+                buf[rampLen - 1] = dest;
+            value = buf[numSamples - 1];
+            return true;
+        }
+
+        // data() = the resting value for the next numSamples samples
+        void fill(int numSamples) noexcept
+        {
+            std::fill(buf.begin(), buf.begin() + numSamples, value);
+        }
+
+        T* data() noexcept { return buf.data(); }
+        T getValue() const noexcept { return value; }
+
+    protected:
+        Span<T> buf;
+        T value, dest, inc;
+        int rampLength, remaining;
+    };
+}
@@ -0,0 +1,64 @@
+#include "Squash.h"
+#include "SimdVec.h"
+
+namespace dsp
+{
+    namespace scalar
+    {
+       #include "SquashKernels.h"
+    }
+}
+
+#if JUCE_INTEL
+SUSQUASH_BEGIN_SSE2
+namespace dsp
+{
+    namespace sse2
+    {
+       #include "SquashKernels.h"
+    }
+}
+SUSQUASH_END_TARGET
+
+SUSQUASH_BEGIN_AVX2
+namespace dsp
+{
+    namespace avx2
+    {
+       #include "SquashKernels.h"
+    }
+}
+SUSQUASH_END_TARGET
+
+SUSQUASH_BEGIN_AVX512
+namespace dsp
+{
+    namespace avx512
+    {
+       #include "SquashKernels.h"
+    }
+}
+SUSQUASH_END_TARGET
+#endif
+
+namespace dsp
+{
+    template<typename T>
+    const SquashKernels<T>& getKernels(ISA isa) noexcept
+    {
+        static const SquashKernels<T> kernels[] =
+        {
+            scalar::makeKernels<T>(ISA::Scalar),
+           #if JUCE_INTEL
+            sse2::makeKernels<T>(ISA::SSE2),
+            avx2::makeKernels<T>(ISA::AVX2),
+            avx512::makeKernels<T>(ISA::AVX512)
+           #endif
+        };
+        const auto idx = static_cast<size_t>(isa);
+        return idx < std::size(kernels) ? kernels[idx] : kernels[0];
+    }
+
+    template const SquashKernels<float>& getKernels(ISA) noexcept;
+    template const SquashKernels<double>& getKernels(ISA) noexcept;
+}
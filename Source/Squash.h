@@ -0,0 +1,109 @@
+#pragma once
+#include "Simd.h"
+
+namespace dsp
+{
+    // what a block with resting parameters has to compute. Bypass: squash is 0,
+    // Full: squash is 100 %, UnityGain: gain is 0 db, Blend: anything else
+    enum class SquashMode { Bypass, Full, FullUnityGain, UnityGain, Blend, NumModes };
+
+    // what the squash blends towards, with u = x / knee. Hard: sign(x),
+    // Soft: tanh(u), Cubic: 1.5u - .5u^3 with u clipped to [-1, 1],
+    // Asymmetric: Soft with a 4 times narrower knee below zero, which adds
+    // even harmonics
+    enum class Curve { Hard, Soft, Cubic, Asymmetric, NumCurves };
+
+    template<typename T>
+    inline SquashMode getSquashMode(T squashV, T gainV) noexcept
+    {
+        if (squashV == T(0))
+            return SquashMode::Bypass;
+        if (squashV == T(1))
+            return gainV == T(1) ? SquashMode::FullUnityGain : SquashMode::Full;
+        return gainV == T(1) ? SquashMode::UnityGain : SquashMode::Blend;
+    }
+
+    // the multiband squash's settings, 4 lanes each, lane b is band b.
+    // crossover section j is biquads 2j and 2j + 1, coefs b0, b1, b2, a1,
+    // a2. squash and gain: the bands' factors at the start and the end of
+    // the block, on top of the whole signal's squash and gain
+    template<typename T>
+    struct Bands
+    {
+        static constexpr int MaxBands = 4, MaxBiquads = 2 * (MaxBands - 1);
+        // per channel: the 2 state values of every biquad
+        static constexpr int StateSize = 2 * MaxBiquads * MaxBands;
+
+        T coefs[MaxBiquads][5][MaxBands];
+        T squash[2][MaxBands], gain[2][MaxBands];
+        int numBiquads;
+    };
+
+    // the squash loop of processBlock, compiled for every isa and for float
+    // and double samples. getKernels() hands out the widest one this cpu supports.
+    template<typename T>
+    struct SquashKernels
+    {
+        // samples[s] += squashV * (gainV * sign(samples[s]) - samples[s]),
+        // one specialization per SquashMode
+        using SquashFunc = void(*)(T* samples, int numSamples, T squashV, T gainV) noexcept;
+        SquashFunc squash[static_cast<int>(SquashMode::NumModes)];
+        // the same with one squash and gain value per sample
+        void(*squashRamp)(T* samples, int numSamples, const T* squashV, const T* gainV) noexcept;
+        // the squash blend towards target[s] instead of sign(samples[s])
+        using BlendFunc = void(*)(T* samples, const T* target, int numSamples, T squashV, T gainV) noexcept;
+        BlendFunc blend[static_cast<int>(SquashMode::NumModes)];
+        void(*blendRamp)(T* samples, const T* target, int numSamples, const T* squashV, const T* gainV) noexcept;
+        // antiderivative antialiased sign(samples) into target, first and second order.
+        // samples get delayed by .5 and 1 sample to line up. state: 2 values per channel
+        using ADAAFunc = void(*)(T* samples, T* target, int numSamples, T* state) noexcept;
+        ADAAFunc adaa1, adaa2;
+        // target[s] = curve(samples[s]), drive = 1 / knee. Hard and Cubic are
+        // exact, Soft and Asymmetric stay within 1.5e-7 of tanh in float and
+        // 8e-8 in double, for |x * drive| up to 20
+        using ShapeFunc = void(*)(const T* samples, T* target, int numSamples, T drive) noexcept;
+        ShapeFunc shape[static_cast<int>(Curve::NumCurves)];
+        // splits a channel into bands, squashes each towards the curve with
+        // its own settings and sums them back up, in place. squashV and
+        // gainV: one value per sample, gain linear. state: Bands::StateSize
+        using MultibandFunc = void(*)(T* samples, int numSamples, const T* squashV, const T* gainV,
+            const Bands<T>& bands, T drive, T* state) noexcept;
+        MultibandFunc multiband[static_cast<int>(Curve::NumCurves)];
+        // buf[s] = 10^(buf[s] / 20), relative error < 6e-7 in float and
+        // 1.7e-7 in double from -64 to 24 db, the gain and band gain range
+        void(*dbToGain)(T* buf, int numSamples) noexcept;
+        // peak, sum of squares and sum of a block, added to stats[0..2]
+        void(*measure)(const T* samples, int numSamples, T* stats) noexcept;
+        // the allpass pairs of the minimum phase half-band, on frames of
+        // lanes interleaved channels. up: out holds 2 * numFrames frames,
+        // down: in does. state: 2 * lanes values per coefficient
+        static constexpr int MaxAllpasses = 8;
+        using HalfBandFunc = void(*)(const T* in, T* out, int numFrames, const T* coefs, int numCoefs, T* state) noexcept;
+        HalfBandFunc halfBandUp, halfBandDown;
+        // the hard curve's sign with hysteresis, on frames of lanes
+        // interleaved channels into out, which may be in. a lane only turns
+        // once the input is past threshold on the other side, no sooner than
+        // holdSamples after it last turned, and falls to 0 once the input has
+        // been within threshold for releaseSamples. state: 3 * lanes values
+        void(*hysteresis)(const T* in, T* out, int numFrames, T threshold, T holdSamples, T releaseSamples,
+            T* state) noexcept;
+        // fully squashed samples as bits, sample s in bit s % 64 of word
+        // s / 64. pack: signs gets 1 where samples[s] > 0, nonzero where
+        // samples[s] != 0, bits past numSamples are 0. unpack writes gain,
+        // -gain or 0 back, starting at bit first
+        void(*pack)(const T* samples, int numSamples, std::uint64_t* signs, std::uint64_t* nonzero) noexcept;
+        void(*unpack)(T* samples, int numSamples, const std::uint64_t* signs, const std::uint64_t* nonzero,
+            int first, T gain) noexcept;
+
+        ISA isa;
+        // samples per register
+        int lanes;
+    };
+
+    // instantiated for float and double in Squash.cpp
+    template<typename T>
+    const SquashKernels<T>& getKernels(ISA isa) noexcept;
+
+    template<typename T>
+    inline const SquashKernels<T>& getKernels() noexcept { return getKernels<T>(getISA()); }
+}
@@ -0,0 +1,576 @@
+// no include guard: Squash.cpp includes this once per instruction set,
+// inside that instruction set's namespace, so VecF and VecD refer to its vector types.
+
+// the vector type of the scalar tails, same element type as V
+template<class V>
+using ScalarVec = std::conditional_t<std::is_same_v<typename V::Type, float>, scalar::VecF, scalar::VecD>;
+
+// x += squashV * (gainV * target - x), with the same operation order as the
+// scalar formula, so every isa produces bit-identical output. the flags
+// strip what the parameter state makes redundant: Full (squashV == 1)
+// returns the target of the blend, UnityGain (gainV == 1) skips the multiply.
+template<class V, bool Full, bool UnityGain>
+inline typename V::Reg blendVec(typename V::Reg x, typename V::Reg target,
+    typename V::Reg squashV, typename V::Reg gainV) noexcept
+{
+    if constexpr (!UnityGain)
+        target = V::mul(gainV, target);
+    if constexpr (Full)
+        return target;
+    else
+        return V::add(x, V::mul(squashV, V::sub(target, x)));
+}
+
+template<class V, bool Full, bool UnityGain>
+inline typename V::Reg squashVec(typename V::Reg x, typename V::Reg squashV, typename V::Reg gainV) noexcept
+{
+    return blendVec<V, Full, UnityGain>(x, V::sign(x), squashV, gainV);
+}
+
+template<class V, bool Full, bool UnityGain>
+inline void squashBlock(typename V::Type* samples, int numSamples,
+    typename V::Type squashV, typename V::Type gainV) noexcept
+{
+    using S = ScalarVec<V>;
+    const auto squashReg = V::set1(squashV);
+    const auto gainReg = V::set1(gainV);
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size)
+        V::store(samples + s, squashVec<V, Full, UnityGain>(V::load(samples + s), squashReg, gainReg));
+    for (; s < numSamples; ++s)
+        samples[s] = squashVec<S, Full, UnityGain>(samples[s], squashV, gainV);
+}
+
+// same as squashBlock but with one squash and gain value per sample
+template<class V>
+inline void squashRampBlock(typename V::Type* samples, int numSamples,
+    const typename V::Type* squashV, const typename V::Type* gainV) noexcept
+{
+    using S = ScalarVec<V>;
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size)
+        V::store(samples + s, squashVec<V, false, false>(V::load(samples + s), V::load(squashV + s), V::load(gainV + s)));
+    for (; s < numSamples; ++s)
+        samples[s] = squashVec<S, false, false>(samples[s], squashV[s], gainV[s]);
+}
+
+// the squash blend towards a precomputed target instead of sign(x)
+template<class V, bool Full, bool UnityGain>
+inline void blendBlock(typename V::Type* samples, const typename V::Type* target, int numSamples,
+    typename V::Type squashV, typename V::Type gainV) noexcept
+{
+    using S = ScalarVec<V>;
+    const auto squashReg = V::set1(squashV);
+    const auto gainReg = V::set1(gainV);
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size)
+        V::store(samples + s, blendVec<V, Full, UnityGain>(V::load(samples + s), V::load(target + s), squashReg, gainReg));
+    for (; s < numSamples; ++s)
+        samples[s] = blendVec<S, Full, UnityGain>(samples[s], target[s], squashV, gainV);
+}
+
+template<class V>
+inline void blendRampBlock(typename V::Type* samples, const typename V::Type* target, int numSamples,
+    const typename V::Type* squashV, const typename V::Type* gainV) noexcept
+{
+    using S = ScalarVec<V>;
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size)
+        V::store(samples + s, blendVec<V, false, false>(V::load(samples + s), V::load(target + s),
+            V::load(squashV + s), V::load(gainV + s)));
+    for (; s < numSamples; ++s)
+        samples[s] = blendVec<S, false, false>(samples[s], target[s], squashV[s], gainV[s]);
+}
+
+// antiderivative antialiasing of sign(x). F1(x) = |x|, F2(x) = x|x| / 2.
+// divided differences whose denominator falls below Tol are replaced by
+// their limit, evaluated at the midpoint.
+template<class V>
+struct ADAA
+{
+    using Reg = typename V::Reg;
+    using Type = typename V::Type;
+    static constexpr Type Tol = static_cast<Type>(1e-5);
+
+    static Reg f2(Reg x) noexcept { return V::mul(V::mul(x, V::abs(x)), V::set1(Type(.5))); }
+
+    // (F1(x0) - F1(x1)) / (x0 - x1)
+    static Reg first(Reg x0, Reg x1) noexcept
+    {
+        const auto d = V::sub(x0, x1);
+        const auto ill = V::lt(V::abs(d), V::set1(Tol));
+        const auto y = V::div(V::sub(V::abs(x0), V::abs(x1)), V::select(ill, V::set1(Type(1)), d));
+        return V::select(ill, V::sign(V::mul(V::add(x0, x1), V::set1(Type(.5)))), y);
+    }
+
+    // (F2(x0) - F2(x1)) / (x0 - x1)
+    static Reg d2(Reg x0, Reg x1) noexcept
+    {
+        const auto d = V::sub(x0, x1);
+        const auto ill = V::lt(V::abs(d), V::set1(Tol));
+        const auto y = V::div(V::sub(f2(x0), f2(x1)), V::select(ill, V::set1(Type(1)), d));
+        return V::select(ill, V::abs(V::mul(V::add(x0, x1), V::set1(Type(.5)))), y);
+    }
+
+    // 2 / (x0 - x2) * (D2(x0, x1) - D2(x1, x2))
+    static Reg second(Reg x0, Reg x1, Reg x2) noexcept
+    {
+        const auto half = V::set1(Type(.5));
+        const auto tol = V::set1(Tol);
+        const auto one = V::set1(Type(1));
+        const auto two = V::set1(Type(2));
+
+        const auto d = V::sub(x0, x2);
+        const auto ill = V::lt(V::abs(d), tol);
+        const auto y = V::div(V::mul(two, V::sub(d2(x0, x1), d2(x1, x2))), V::select(ill, one, d));
+
+        // x0 close to x2: expand around their mean instead
+        const auto xBar = V::mul(V::add(x0, x2), half);
+        const auto delta = V::sub(xBar, x1);
+        const auto illDelta = V::lt(V::abs(delta), tol);
+        const auto deltaSafe = V::select(illDelta, one, delta);
+        const auto yFallback = V::mul(V::div(two, deltaSafe),
+            V::add(V::abs(xBar), V::div(V::sub(f2(x1), f2(xBar)), deltaSafe)));
+        const auto yFlat = V::sign(V::mul(V::add(xBar, x1), half));
+
+        // no zero crossing in the window: exactly the sign. also keeps the
+        // cancellation in the divided differences of large values out
+        const auto zero = V::set1(Type(0));
+        const auto lo = V::min(V::min(x0, x1), x2);
+        const auto hi = V::max(V::max(x0, x1), x2);
+        const auto minusOne = V::set1(Type(-1));
+        // a weighted mean of sign(x) can't leave [-1, 1], rounding near zero can
+        const auto yAdaa = V::max(minusOne, V::min(one, V::select(ill, V::select(illDelta, yFlat, yFallback), y)));
+        return V::select(V::gt(lo, zero), one, V::select(V::lt(hi, zero), minusOne, yAdaa));
+    }
+};
+
+// target = first order adaa of sign(samples), samples = samples delayed by
+// half a sample to line up with it. state = { x[-1], x[-2] }.
+// works backwards, so the unprocessed samples double as input history.
+template<class V>
+inline void adaa1Block(typename V::Type* samples, typename V::Type* target, int numSamples,
+    typename V::Type* state) noexcept
+{
+    using S = ScalarVec<V>;
+    using A = ADAA<V>;
+    using AS = ADAA<S>;
+    if (numSamples == 0)
+        return;
+    const auto half = V::set1(typename V::Type(.5));
+    const auto x1Next = samples[numSamples - 1];
+    const auto x2Next = numSamples > 1 ? samples[numSamples - 2] : state[0];
+
+    auto s = numSamples;
+    while (s - V::size >= 1) {
+        s -= V::size;
+        const auto x0 = V::load(samples + s);
+        const auto x1 = V::load(samples + s - 1);
+        V::store(target + s, A::first(x0, x1));
+        V::store(samples + s, V::mul(V::add(x0, x1), half));
+    }
+    while (s-- > 0) {
+        const auto x0 = samples[s];
+        const auto x1 = s > 0 ? samples[s - 1] : state[0];
+        target[s] = AS::first(x0, x1);
+        samples[s] = (x0 + x1) * typename V::Type(.5);
+    }
+    state[0] = x1Next;
+    state[1] = x2Next;
+}
+
+// target = second order adaa of sign(samples), samples delayed by one sample
+template<class V>
+inline void adaa2Block(typename V::Type* samples, typename V::Type* target, int numSamples,
+    typename V::Type* state) noexcept
+{
+    using S = ScalarVec<V>;
+    using A = ADAA<V>;
+    using AS = ADAA<S>;
+    if (numSamples == 0)
+        return;
+    const auto x1Next = samples[numSamples - 1];
+    const auto x2Next = numSamples > 1 ? samples[numSamples - 2] : state[0];
+
+    auto s = numSamples;
+    while (s - V::size >= 2) {
+        s -= V::size;
+        const auto x0 = V::load(samples + s);
+        const auto x1 = V::load(samples + s - 1);
+        V::store(target + s, A::second(x0, x1, V::load(samples + s - 2)));
+        V::store(samples + s, x1);
+    }
+    while (s-- > 0) {
+        const auto x0 = samples[s];
+        const auto x1 = s > 0 ? samples[s - 1] : state[0];
+        const auto x2 = s > 1 ? samples[s - 2] : s == 1 ? state[0] : state[1];
+        target[s] = AS::second(x0, x1, x2);
+        samples[s] = x1;
+    }
+    state[0] = x1Next;
+    state[1] = x2Next;
+}
+
+// 2^x as 2^round(x) * 2^f, f in [-.5, .5], with the taylor series of 2^f
+// up to f^6. the polynomial's relative error peaks at f = +-.5, 1.7e-7,
+// float rounding comes on top of that for the normal range.
+template<class V>
+inline typename V::Reg exp2Vec(typename V::Reg x) noexcept
+{
+    using Type = typename V::Type;
+    const auto n = V::round(x);
+    const auto f = V::sub(x, n);
+    auto p = V::set1(Type(1.54035304e-4));
+    p = V::add(V::mul(p, f), V::set1(Type(1.33335581e-3)));
+    p = V::add(V::mul(p, f), V::set1(Type(9.61812911e-3)));
+    p = V::add(V::mul(p, f), V::set1(Type(5.55041087e-2)));
+    p = V::add(V::mul(p, f), V::set1(Type(2.40226507e-1)));
+    p = V::add(V::mul(p, f), V::set1(Type(6.93147181e-1)));
+    p = V::add(V::mul(p, f), V::set1(Type(1)));
+    return V::mul(p, V::pow2i(n));
+}
+
+// tanh(x) = (1 - e) / (1 + e) with e = 2^(-2|x| log2(e)), and the sign of x
+// put back. |x| gets clipped at 20, where tanh is 1 in double precision.
+// with e's relative error r, y is off by 2er / (1 + e)^2, which is at most
+// r / 2, at e = 1
+template<class V>
+inline typename V::Reg tanhVec(typename V::Reg x) noexcept
+{
+    using Type = typename V::Type;
+    static constexpr Type MinusTwoLog2E = Type(-2.88539008177792681);
+    const auto one = V::set1(Type(1));
+    const auto a = V::min(V::abs(x), V::set1(Type(20)));
+    const auto e = exp2Vec<V>(V::mul(a, V::set1(MinusTwoLog2E)));
+    const auto y = V::div(V::sub(one, e), V::add(one, e));
+    return V::select(V::lt(x, V::set1(Type(0))), V::sub(V::set1(Type(0)), y), y);
+}
+
+template<class V, Curve C>
+inline typename V::Reg curveVec(typename V::Reg x, typename V::Reg drive) noexcept
+{
+    using Type = typename V::Type;
+    if constexpr (C == Curve::Hard)
+        return V::sign(x);
+    else if constexpr (C == Curve::Soft)
+        return tanhVec<V>(V::mul(x, drive));
+    else if constexpr (C == Curve::Cubic) {
+        const auto u = V::max(V::set1(Type(-1)), V::min(V::set1(Type(1)), V::mul(x, drive)));
+        return V::mul(u, V::sub(V::set1(Type(1.5)), V::mul(V::set1(Type(.5)), V::mul(u, u))));
+    }
+    else {
+        const auto d = V::select(V::lt(x, V::set1(Type(0))), V::mul(drive, V::set1(Type(4))), drive);
+        return tanhVec<V>(V::mul(x, d));
+    }
+}
+
+template<class V, Curve C>
+inline void shapeBlock(const typename V::Type* samples, typename V::Type* target, int numSamples,
+    typename V::Type drive) noexcept
+{
+    using S = ScalarVec<V>;
+    const auto driveReg = V::set1(drive);
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size)
+        V::store(target + s, curveVec<V, C>(V::load(samples + s), driveReg));
+    for (; s < numSamples; ++s)
+        target[s] = curveVec<S, C>(samples[s], drive);
+}
+
+// lane b of the 4 lane vector is band b. per sample: the crossover
+// sections in transposed direct form 2, the squash with the band's settings
+// ramping across the block, then the lanes get summed. lane b's section j
+// is a highpass below its band (j < b), a lowpass above it (j == b) or an
+// allpass (j > b) with the same phase as the sections the other bands got,
+// so the bands sum to an allpass
+template<class V, Curve C>
+inline void multibandBlock(typename V::Type* samples, int numSamples, const typename V::Type* squashV,
+    const typename V::Type* gainV, const Bands<typename V::Type>& bands, typename V::Type drive,
+    typename V::Type* state) noexcept
+{
+    using Type = typename V::Type;
+    using V4 = std::conditional_t<std::is_same_v<Type, float>, Vec4F, Vec4D>;
+    using Reg = typename V4::Reg;
+    static constexpr int MaxBiquads = Bands<Type>::MaxBiquads;
+    static_assert(V4::size == Bands<Type>::MaxBands, "one lane per band");
+    if (numSamples == 0)
+        return;
+
+    const auto numBiquads = bands.numBiquads;
+    Reg c[MaxBiquads][5], s1[MaxBiquads], s2[MaxBiquads];
+    for (auto i = 0; i < numBiquads; ++i) {
+        for (auto k = 0; k < 5; ++k)
+            c[i][k] = V4::load(bands.coefs[i][k]);
+        s1[i] = V4::load(state + 2 * i * V4::size);
+        s2[i] = V4::load(state + (2 * i + 1) * V4::size);
+    }
+    const auto stepScale = V4::set1(Type(1) / static_cast<Type>(numSamples));
+    auto bandSquash = V4::load(bands.squash[0]);
+    auto bandGain = V4::load(bands.gain[0]);
+    const auto squashStep = V4::mul(V4::sub(V4::load(bands.squash[1]), bandSquash), stepScale);
+    const auto gainStep = V4::mul(V4::sub(V4::load(bands.gain[1]), bandGain), stepScale);
+    const auto driveReg = V4::set1(drive);
+
+    Type lanes[V4::size];
+    for (auto s = 0; s < numSamples; ++s) {
+        auto x = V4::set1(samples[s]);
+        for (auto i = 0; i < numBiquads; ++i) {
+            const auto y = V4::add(V4::mul(c[i][0], x), s1[i]);
+            s1[i] = V4::sub(V4::add(V4::mul(c[i][1], x), s2[i]), V4::mul(c[i][3], y));
+            s2[i] = V4::sub(V4::mul(c[i][2], x), V4::mul(c[i][4], y));
+            x = y;
+        }
+        bandSquash = V4::add(bandSquash, squashStep);
+        bandGain = V4::add(bandGain, gainStep);
+        const auto sq = V4::mul(bandSquash, V4::set1(squashV[s]));
+        const auto g = V4::mul(bandGain, V4::set1(gainV[s]));
+        V4::store(lanes, blendVec<V4, false, false>(x, curveVec<V4, C>(x, driveReg), sq, g));
+        samples[s] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    for (auto i = 0; i < numBiquads; ++i) {
+        V4::store(state + 2 * i * V4::size, s1[i]);
+        V4::store(state + (2 * i + 1) * V4::size, s2[i]);
+    }
+}
+
+// decibels to gain in place, 10^(db/20) = 2^(db * log2(10) / 20)
+template<class V>
+inline void dbToGainBlock(typename V::Type* buf, int numSamples) noexcept
+{
+    using S = ScalarVec<V>;
+    using Type = typename V::Type;
+    static constexpr Type DbToLog2 = Type(0.166096404744368);
+    const auto dbToLog2 = V::set1(DbToLog2);
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size)
+        V::store(buf + s, exp2Vec<V>(V::mul(V::load(buf + s), dbToLog2)));
+    for (; s < numSamples; ++s)
+        buf[s] = exp2Vec<S>(buf[s] * DbToLog2);
+}
+
+// stats[0] = max(stats[0], |x|), stats[1] += x * x, stats[2] += x over the
+// block. one accumulator per lane, reduced once at the end
+template<class V>
+inline void measureBlock(const typename V::Type* samples, int numSamples, typename V::Type* stats) noexcept
+{
+    using Type = typename V::Type;
+    auto peak = V::set1(Type(0));
+    auto sumSq = peak, sum = peak;
+    auto s = 0;
+    for (; s + V::size <= numSamples; s += V::size) {
+        const auto x = V::load(samples + s);
+        peak = V::max(peak, V::abs(x));
+        sumSq = V::add(sumSq, V::mul(x, x));
+        sum = V::add(sum, x);
+    }
+    Type lanes[3][V::size];
+    V::store(lanes[0], peak);
+    V::store(lanes[1], sumSq);
+    V::store(lanes[2], sum);
+    for (auto l = 0; l < V::size; ++l) {
+        stats[0] = std::max(stats[0], lanes[0][l]);
+        stats[1] += lanes[1][l];
+        stats[2] += lanes[2][l];
+    }
+    for (; s < numSamples; ++s) {
+        stats[0] = std::max(stats[0], std::abs(samples[s]));
+        stats[1] += samples[s] * samples[s];
+        stats[2] += samples[s];
+    }
+}
+
+// every lane of V is one channel's filter. coefficients alternate between
+// the paths, the state holds x[n-1] and y[n-1] of each allpass
+template<class V>
+struct AllpassPair
+{
+    using Reg = typename V::Reg;
+    using Type = typename V::Type;
+    static constexpr int MaxAllpasses = SquashKernels<Type>::MaxAllpasses;
+
+    AllpassPair(const Type* coefs, int _numCoefs, Type* _state) noexcept :
+        c(), x1(), y1(), numCoefs(_numCoefs), state(_state)
+    {
+        for (auto i = 0; i < numCoefs; ++i) {
+            c[i] = V::set1(coefs[i]);
+            x1[i] = V::load(state + 2 * i * V::size);
+            y1[i] = V::load(state + (2 * i + 1) * V::size);
+        }
+    }
+
+    void save() noexcept
+    {
+        for (auto i = 0; i < numCoefs; ++i) {
+            V::store(state + 2 * i * V::size, x1[i]);
+            V::store(state + (2 * i + 1) * V::size, y1[i]);
+        }
+    }
+
+    void operator()(Reg& even, Reg& odd) noexcept
+    {
+        for (auto i = 0; i < numCoefs; ++i) {
+            auto& x = i % 2 == 0 ? even : odd;
+            const auto y = V::add(V::mul(V::sub(x, y1[i]), c[i]), x1[i]);
+            x1[i] = x;
+            y1[i] = y;
+            x = y;
+        }
+    }
+
+    Reg c[MaxAllpasses], x1[MaxAllpasses], y1[MaxAllpasses];
+    int numCoefs;
+    Type* state;
+};
+
+template<class V>
+inline void halfBandUpBlock(const typename V::Type* in, typename V::Type* out, int numFrames,
+    const typename V::Type* coefs, int numCoefs, typename V::Type* state) noexcept
+{
+    AllpassPair<V> allpass(coefs, numCoefs, state);
+    for (auto s = 0; s < numFrames; ++s) {
+        auto even = V::load(in + s * V::size);
+        auto odd = even;
+        allpass(even, odd);
+        V::store(out + 2 * s * V::size, even);
+        V::store(out + (2 * s + 1) * V::size, odd);
+    }
+    allpass.save();
+}
+
+template<class V>
+inline void halfBandDownBlock(const typename V::Type* in, typename V::Type* out, int numFrames,
+    const typename V::Type* coefs, int numCoefs, typename V::Type* state) noexcept
+{
+    const auto half = V::set1(typename V::Type(.5));
+    AllpassPair<V> allpass(coefs, numCoefs, state);
+    for (auto s = 0; s < numFrames; ++s) {
+        auto even = V::load(in + (2 * s + 1) * V::size);
+        auto odd = V::load(in + 2 * s * V::size);
+        allpass(even, odd);
+        V::store(out + s * V::size, V::mul(half, V::add(even, odd)));
+    }
+    allpass.save();
+}
+
+// a lane per channel, since every sample depends on the one before. the
+// branches are selects and the counters count samples in T, which stays
+// exact far past any release
+template<class V>
+inline void hysteresisBlock(const typename V::Type* in, typename V::Type* out, int numFrames,
+    typename V::Type threshold, typename V::Type holdSamples, typename V::Type releaseSamples,
+    typename V::Type* state) noexcept
+{
+    using Type = typename V::Type;
+    const auto zero = V::set1(Type(0)), one = V::set1(Type(1)), half = V::set1(Type(.5));
+    const auto thresholdReg = V::set1(threshold), hold = V::set1(holdSamples), release = V::set1(releaseSamples);
+    auto y = V::load(state), wait = V::load(state + V::size), quiet = V::load(state + 2 * V::size);
+    for (auto s = 0; s < numFrames; ++s) {
+        const auto x = V::load(in + s * V::size);
+        const auto past = V::gt(V::abs(x), thresholdReg);
+        quiet = V::select(past, zero, V::min(V::add(quiet, one), release));
+        const auto wanted = V::select(past, V::sign(x), V::select(V::lt(quiet, release), y, zero));
+        wait = V::max(V::sub(wait, one), zero);
+        const auto next = V::select(V::lt(wait, half), wanted, y);
+        wait = V::select(V::gt(V::abs(V::sub(next, y)), zero), hold, wait);
+        y = next;
+        V::store(out + s * V::size, y);
+    }
+    V::store(state, y);
+    V::store(state + V::size, wait);
+    V::store(state + 2 * V::size, quiet);
+}
+
+// the bits of 64 samples a word, V::size of them per compare
+template<class V>
+inline void packBlock(const typename V::Type* samples, int numSamples,
+    std::uint64_t* signs, std::uint64_t* nonzero) noexcept
+{
+    using Type = typename V::Type;
+    const auto zero = V::set1(Type(0));
+    auto s = 0;
+    for (; s + 64 <= numSamples; s += 64) {
+        std::uint64_t pos = 0, neg = 0;
+        for (auto l = 0; l < 64; l += V::size) {
+            const auto x = V::load(samples + s + l);
+            pos |= static_cast<std::uint64_t>(V::toBits(V::gt(x, zero))) << l;
+            neg |= static_cast<std::uint64_t>(V::toBits(V::lt(x, zero))) << l;
+        }
+        signs[s / 64] = pos;
+        nonzero[s / 64] = pos | neg;
+    }
+    if (s == numSamples)
+        return;
+    std::uint64_t pos = 0, neg = 0;
+    for (auto l = 0; s + l < numSamples; ++l) {
+        pos |= static_cast<std::uint64_t>(samples[s + l] > Type(0)) << l;
+        neg |= static_cast<std::uint64_t>(samples[s + l] < Type(0)) << l;
+    }
+    signs[s / 64] = pos;
+    nonzero[s / 64] = pos | neg;
+}
+
+template<class V>
+inline void unpackBlock(typename V::Type* samples, int numSamples, const std::uint64_t* signs,
+    const std::uint64_t* nonzero, int first, typename V::Type gain) noexcept
+{
+    using Type = typename V::Type;
+    const auto bit = [&](const std::uint64_t* words, int b) noexcept { return (words[b / 64] >> (b % 64)) & 1; };
+    const auto unpackOne = [&](int b) noexcept {
+        return bit(nonzero, b) == 0 ? Type(0) : bit(signs, b) != 0 ? gain : -gain;
+    };
+    auto s = 0;
+    // up to the next word
+    for (; s < numSamples && (first + s) % 64 != 0; ++s)
+        samples[s] = unpackOne(first + s);
+    const auto pos = V::set1(gain), neg = V::set1(-gain), zero = V::set1(Type(0));
+    for (; s + 64 <= numSamples; s += 64) {
+        const auto w = (first + s) / 64;
+        for (auto l = 0; l < 64; l += V::size) {
+            const auto sign = static_cast<unsigned>(signs[w] >> l);
+            const auto nz = static_cast<unsigned>(nonzero[w] >> l);
+            V::store(samples + s + l, V::select(V::fromBits(nz), V::select(V::fromBits(sign), pos, neg), zero));
+        }
+    }
+    for (; s < numSamples; ++s)
+        samples[s] = unpackOne(first + s);
+}
+
+template<typename T>
+inline SquashKernels<T> makeKernels(ISA isa) noexcept
+{
+    using V = std::conditional_t<std::is_same_v<T, float>, VecF, VecD>;
+    SquashKernels<T> k;
+    k.squash[static_cast<int>(SquashMode::Bypass)] = [](T*, int, T, T) noexcept {};
+    k.squash[static_cast<int>(SquashMode::Full)] = &squashBlock<V, true, false>;
+    k.squash[static_cast<int>(SquashMode::FullUnityGain)] = &squashBlock<V, true, true>;
+    k.squash[static_cast<int>(SquashMode::UnityGain)] = &squashBlock<V, false, true>;
+    k.squash[static_cast<int>(SquashMode::Blend)] = &squashBlock<V, false, false>;
+    k.blend[static_cast<int>(SquashMode::Bypass)] = [](T*, const T*, int, T, T) noexcept {};
+    k.blend[static_cast<int>(SquashMode::Full)] = &blendBlock<V, true, false>;
+    k.blend[static_cast<int>(SquashMode::FullUnityGain)] = &blendBlock<V, true, true>;
+    k.blend[static_cast<int>(SquashMode::UnityGain)] = &blendBlock<V, false, true>;
+    k.blend[static_cast<int>(SquashMode::Blend)] = &blendBlock<V, false, false>;
+    k.squashRamp = &squashRampBlock<V>;
+    k.blendRamp = &blendRampBlock<V>;
+    k.adaa1 = &adaa1Block<V>;
+    k.adaa2 = &adaa2Block<V>;
+    k.shape[static_cast<int>(Curve::Hard)] = &shapeBlock<V, Curve::Hard>;
+    k.shape[static_cast<int>(Curve::Soft)] = &shapeBlock<V, Curve::Soft>;
+    k.shape[static_cast<int>(Curve::Cubic)] = &shapeBlock<V, Curve::Cubic>;
+    k.shape[static_cast<int>(Curve::Asymmetric)] = &shapeBlock<V, Curve::Asymmetric>;
+    k.multiband[static_cast<int>(Curve::Hard)] = &multibandBlock<V, Curve::Hard>;
+    k.multiband[static_cast<int>(Curve::Soft)] = &multibandBlock<V, Curve::Soft>;
+    k.multiband[static_cast<int>(Curve::Cubic)] = &multibandBlock<V, Curve::Cubic>;
+    k.multiband[static_cast<int>(Curve::Asymmetric)] = &multibandBlock<V, Curve::Asymmetric>;
+    k.dbToGain = &dbToGainBlock<V>;
+    k.measure = &measureBlock<V>;
+    k.halfBandUp = &halfBandUpBlock<V>;
+    k.halfBandDown = &halfBandDownBlock<V>;
+    k.hysteresis = &hysteresisBlock<V>;
+    k.pack = &packBlock<V>;
+    k.unpack = &unpackBlock<V>;
+    k.isa = isa;
+    k.lanes = V::size;
+    return k;
+}
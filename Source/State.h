@@ -0,0 +1,182 @@
+#pragma once
+#include <JuceHeader.h>
+#include "LiterallyEverything.h"
+
+namespace state
+{
+    // the plugin's state as a flat little endian block with fixed offsets,
+    // so saving and loading is one pass over the parameters with no xml in
+    // between. the layout, version 1:
+    //
+    //  0  magic 'sqsh'
+    //  4  version, uint16
+    //  6  number of parameters, uint16
+    //  8  checksum of everything from offset 12 on, uint32
+    // 12  which of the editor's properties follow, uint32
+    // 16  editor width, height and background seed, int32 each
+    // 28  the parameters' values in param::ID order, float32 each
+    //
+    // parameters only ever get appended, so that doesn't need a new
+    // version. old states leave the ones they don't know at their defaults.
+    // anything else added to apvts.state needs a place in here too
+    struct Binary
+    {
+        static constexpr juce::uint32 Magic = 0x68737173; // "sqsh"
+        static constexpr juce::uint16 Version = 1;
+        enum Offset { MagicOffset = 0, VersionOffset = 4, NumParamsOffset = 6, ChecksumOffset = 8,
+            FlagsOffset = 12, WidthOffset = 16, HeightOffset = 20, SeedOffset = 24, ParamsOffset = 28 };
+        enum Flag { HasSize = 1, HasSeed = 2 };
+
+        Binary(juce::AudioProcessorValueTreeState& _apvts) :
+            apvts(_apvts),
+            params(),
+            values()
+        {
+            for (auto i = 0; i < param::NumIDs; ++i) {
+                const auto id = param::getID(i);
+                params[i] = apvts.getParameter(id);
+                values[i] = apvts.getRawParameterValue(id);
+            }
+        }
+
+        static constexpr size_t getSize(int numParams) noexcept
+        {
+            return static_cast<size_t>(ParamsOffset) + 4 * static_cast<size_t>(numParams);
+        }
+
+        static bool isBinary(const void* data, int sizeInBytes) noexcept
+        {
+            return sizeInBytes >= ParamsOffset && readInt(static_cast<const juce::uint8*>(data) + MagicOffset) == Magic;
+        }
+
+        void write(juce::MemoryBlock& dest) const
+        {
+            dest.setSize(getSize(param::NumIDs), false);
+            auto data = static_cast<juce::uint8*>(dest.getData());
+
+            const auto& state = apvts.state;
+            juce::uint32 flags = 0;
+            if (state.hasProperty(widthID) && state.hasProperty(heightID))
+                flags |= HasSize;
+            if (state.hasProperty(seedID))
+                flags |= HasSeed;
+
+            writeInt(data + MagicOffset, Magic);
+            writeShort(data + VersionOffset, Version);
+            writeShort(data + NumParamsOffset, static_cast<juce::uint16>(param::NumIDs));
+            writeInt(data + FlagsOffset, flags);
+            writeInt(data + WidthOffset, static_cast<juce::uint32>(static_cast<int>(state.getProperty(widthID, 0))));
+            writeInt(data + HeightOffset, static_cast<juce::uint32>(static_cast<int>(state.getProperty(heightID, 0))));
+            writeInt(data + SeedOffset, static_cast<juce::uint32>(static_cast<int>(state.getProperty(seedID, 0))));
+            for (auto i = 0; i < param::NumIDs; ++i)
+                writeFloat(data + ParamsOffset + 4 * i, values[i]->load());
+            writeInt(data + ChecksumOffset, getChecksum(data, dest.getSize()));
+        }
+
+        // false if it's not a state this can read, then nothing changed.
+        // the values go into apvts.state's parameter trees, where the apvts
+        // passes them on to the parameters and the host. only the ones that
+        // differ, so the state an instance already has changes nothing
+        bool read(const void* src, int sizeInBytes)
+        {
+            if (!isBinary(src, sizeInBytes))
+                return false;
+            const auto data = static_cast<const juce::uint8*>(src);
+            const auto size = static_cast<size_t>(sizeInBytes);
+            const auto numParams = static_cast<int>(readShort(data + NumParamsOffset));
+            if (readShort(data + VersionOffset) != Version
+                || size < getSize(numParams)
+                || readInt(data + ChecksumOffset) != getChecksum(data, getSize(numParams))) {
+                jassertfalse;
+                return false;
+            }
+
+            auto state = apvts.state;
+            for (auto i = 0; i < param::NumIDs; ++i) {
+                const auto& p = *params[i];
+                const auto value = i < numParams
+                    ? readFloat(data + ParamsOffset + 4 * i)
+                    : p.convertFrom0to1(p.getDefaultValue());
+                if (value == values[i]->load())
+                    continue;
+                auto child = state.getChildWithProperty(idID, p.paramID);
+                if (!child.isValid()) {
+                    child = juce::ValueTree(paramType);
+                    child.setProperty(idID, p.paramID, nullptr);
+                    state.appendChild(child, nullptr);
+                }
+                child.setProperty(valueID, value, nullptr);
+            }
+
+            const auto flags = readInt(data + FlagsOffset);
+            if (flags & HasSize) {
+                setProperty(state, widthID, static_cast<int>(readInt(data + WidthOffset)));
+                setProperty(state, heightID, static_cast<int>(readInt(data + HeightOffset)));
+            }
+            if (flags & HasSeed)
+                setProperty(state, seedID, static_cast<int>(readInt(data + SeedOffset)));
+            return true;
+        }
+
+    protected:
+        juce::AudioProcessorValueTreeState& apvts;
+        std::array<juce::RangedAudioParameter*, param::NumIDs> params;
+        std::array<std::atomic<float>*, param::NumIDs> values;
+
+        // the editor's properties in apvts.state
+        static inline const juce::Identifier widthID { "width" }, heightID { "height" }, seedID { "bgseed" };
+        // how apvts.state holds a parameter
+        static inline const juce::Identifier paramType { "PARAM" }, idID { "id" }, valueID { "value" };
+
+        static void setProperty(juce::ValueTree& state, const juce::Identifier& id, int value)
+        {
+            if (!state.hasProperty(id) || static_cast<int>(state.getProperty(id)) != value)
+                state.setProperty(id, value, nullptr);
+        }
+
+        // fnv-1a
+        static juce::uint32 getChecksum(const juce::uint8* data, size_t size) noexcept
+        {
+            juce::uint32 hash = 2166136261u;
+            for (auto i = static_cast<size_t>(FlagsOffset); i < size; ++i)
+                hash = (hash ^ data[i]) * 16777619u;
+            return hash;
+        }
+
+        static void writeShort(juce::uint8* d, juce::uint16 v) noexcept
+        {
+            d[0] = static_cast<juce::uint8>(v);
+            d[1] = static_cast<juce::uint8>(v >> 8);
+        }
+        static void writeInt(juce::uint8* d, juce::uint32 v) noexcept
+        {
+            for (auto b = 0; b < 4; ++b)
+                d[b] = static_cast<juce::uint8>(v >> (8 * b));
+        }
+        static void writeFloat(juce::uint8* d, float v) noexcept
+        {
+            juce::uint32 bits;
+            std::memcpy(&bits, &v, 4);
+            writeInt(d, bits);
+        }
+
+        static juce::uint16 readShort(const juce::uint8* d) noexcept
+        {
+            return static_cast<juce::uint16>(d[0] | (d[1] << 8));
+        }
+        static juce::uint32 readInt(const juce::uint8* d) noexcept
+        {
+            juce::uint32 v = 0;
+            for (auto b = 0; b < 4; ++b)
+                v |= static_cast<juce::uint32>(d[b]) << (8 * b);
+            return v;
+        }
+        static float readFloat(const juce::uint8* d) noexcept
+        {
+            const auto bits = readInt(d);
+            float v;
+            std::memcpy(&v, &bits, 4);
+            return v;
+        }
+    };
+}
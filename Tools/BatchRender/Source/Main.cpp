@@ -0,0 +1,390 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include <mutex>
+#include "../../../Source/PluginProcessor.h"
+#include "../../../Source/PackedFormat.h"
+
+// renders audio files through SusquashAudioProcessor, no host, no editor.
+// every worker thread owns one processor, files get handed out by a thread pool.
+
+namespace render
+{
+    static constexpr int DefaultBlockSize = 8192;
+
+    // a parameter value from a point in time on, in seconds of the input
+    struct Point
+    {
+        double seconds;
+        param::ID id;
+        float value;
+    };
+
+    struct Settings
+    {
+        juce::Array<juce::File> inputs;
+        juce::File outputDir, profile;
+        // the output's extension, empty keeps the input's
+        juce::String format;
+        juce::MemoryBlock state;
+        juce::StringPairArray params;
+        std::vector<Point> automation;
+        int blockSize = DefaultBlockSize;
+        int numThreads = juce::SystemStats::getNumCpus();
+    };
+
+    struct Result
+    {
+        juce::String error;
+        juce::int64 numSamples = 0;
+        int numChannels = 0;
+        double sampleRate = 0., seconds = 0.;
+        dsp::Profiler::Snapshot profile {};
+    };
+
+    inline void printUsage()
+    {
+        std::cout <<
+            "usage: susquash-render [options] <file or directory>...\n"
+            "  -o, --output <dir>   where the rendered files go. default: next to the\n"
+            "                       input, with a _squashed suffix\n"
+            "  --state <file>       parameter state as saved by getStateInformation\n"
+            "  --set <id>=<value>   parameter value in its own unit, e.g. --set squash=50.\n"
+            "                       applied after --state\n"
+            "  --automation <file>  sample accurate changes, one per line:\n"
+            "                       <seconds> <id> <value>, for squash, gain and link\n"
+            "  --block <n>          block size, default " << DefaultBlockSize << "\n"
+            "  --threads <n>        worker threads, default: one per core\n"
+            "  --profile <file>     write processBlock's load per file there, as json\n"
+            "  --format <ext>       write wav, aiff, flac or sqb instead of the input's format.\n"
+            "                       sqb packs fully squashed audio into 1 bit per sample, it\n"
+            "                       needs squash at 100 %, the hard curve, no anti alias, no\n"
+            "                       oversampling and 1 band. susquash-play reads it\n"
+            "reads wav, aiff and flac\n";
+    }
+
+    inline juce::String parseAutomation(const juce::File& file, std::vector<Point>& points)
+    {
+        juce::StringArray lines;
+        file.readLines(lines);
+        for (auto l = 0; l < lines.size(); ++l) {
+            const auto line = lines[l].upToFirstOccurrenceOf("#", false, false).trim();
+            if (line.isEmpty())
+                continue;
+            const auto tokens = juce::StringArray::fromTokens(line, false);
+            auto i = 0;
+            if (tokens.size() == 3)
+                for (; i < param::NumIDs; ++i)
+                    if (param::getID(static_cast<param::ID>(i)) == tokens[1])
+                        break;
+            const auto id = static_cast<param::ID>(i);
+            if (tokens.size() != 3 || i == param::NumIDs || !dsp::Automation::isSampleAccurate(id))
+                return file.getFileName() + ":" + juce::String(l + 1) + ": expected <seconds> <id> <value>, "
+                    "with id squash, gain or link";
+            points.push_back({ tokens[0].getDoubleValue(), id, tokens[2].getFloatValue() });
+        }
+        std::stable_sort(points.begin(), points.end(), [](const Point& a, const Point& b) { return a.seconds < b.seconds; });
+        return {};
+    }
+
+    inline juce::String parseArgs(const juce::StringArray& args, Settings& settings)
+    {
+        for (auto i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if ((arg == "-o" || arg == "--output") && hasValue)
+                settings.outputDir = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--state" && hasValue) {
+                const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+                if (!file.loadFileAsData(settings.state))
+                    return "can't read state " + file.getFullPathName();
+            }
+            else if (arg == "--set" && hasValue) {
+                const auto pair = args[++i];
+                if (!pair.containsChar('='))
+                    return "--set expects <id>=<value>, got " + pair;
+                settings.params.set(pair.upToFirstOccurrenceOf("=", false, false).trim(),
+                    pair.fromFirstOccurrenceOf("=", false, false).trim());
+            }
+            else if (arg == "--automation" && hasValue) {
+                const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+                if (!file.existsAsFile())
+                    return "can't read automation " + file.getFullPathName();
+                const auto error = parseAutomation(file, settings.automation);
+                if (error.isNotEmpty())
+                    return error;
+            }
+            else if (arg == "--block" && hasValue)
+                settings.blockSize = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--threads" && hasValue)
+                settings.numThreads = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--profile" && hasValue)
+                settings.profile = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--format" && hasValue) {
+                settings.format = "." + args[++i].trimCharactersAtStart(".").toLowerCase();
+                if (!juce::StringArray { ".wav", ".aif", ".aiff", ".flac", ".sqb" }.contains(settings.format))
+                    return "can't write " + settings.format;
+            }
+            else if (arg.startsWith("-"))
+                return "unknown option " + arg;
+            else {
+                const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+                if (file.isDirectory())
+                    settings.inputs.addArray(file.findChildFiles(juce::File::findFiles, false, "*.wav;*.aif;*.aiff;*.flac"));
+                else if (file.existsAsFile())
+                    settings.inputs.add(file);
+                else
+                    return "no such file " + file.getFullPathName();
+            }
+        }
+        if (settings.inputs.isEmpty())
+            return "no input files";
+        return {};
+    }
+
+    // wav and aiff get mapped into memory, everything else streams
+    inline std::unique_ptr<juce::AudioFormatReader> createReader(juce::AudioFormatManager& formats, const juce::File& file)
+    {
+        if (auto format = formats.findFormatForFileExtension(file.getFileExtension())) {
+            std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+            if (mapped != nullptr && mapped->mapEntireFile())
+                return mapped;
+        }
+        return std::unique_ptr<juce::AudioFormatReader>(formats.createReaderFor(file));
+    }
+
+    inline juce::File getOutputFile(const juce::File& input, const Settings& settings)
+    {
+        const auto extension = settings.format.isNotEmpty() ? settings.format : input.getFileExtension();
+        if (settings.outputDir != juce::File())
+            return settings.outputDir.getChildFile(input.getFileNameWithoutExtension() + extension);
+        return input.getSiblingFile(input.getFileNameWithoutExtension() + "_squashed" + extension);
+    }
+
+    // the largest bit depth the format writes that doesn't exceed the input's
+    inline int getBitDepth(juce::AudioFormat& format, int bitsPerSample)
+    {
+        const auto depths = format.getPossibleBitDepths();
+        auto best = depths.isEmpty() ? 16 : depths.getFirst();
+        for (auto depth : depths)
+            if (depth <= bitsPerSample)
+                best = juce::jmax(best, depth);
+        return best;
+    }
+
+    inline Result renderFile(SusquashAudioProcessor& processor, const juce::File& input, const juce::File& output,
+        int blockSize, const std::vector<Point>& automation)
+    {
+        Result result;
+        juce::AudioFormatManager formats;
+        formats.registerBasicFormats();
+        formats.registerFormat(new packed::Format(), false);
+
+        const auto reader = createReader(formats, input);
+        if (reader == nullptr) {
+            result.error = "can't read " + input.getFullPathName();
+            return result;
+        }
+        const auto numChannels = static_cast<int>(reader->numChannels);
+        const auto sampleRate = reader->sampleRate;
+        const auto length = reader->lengthInSamples;
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        processor.releaseResources();
+        if (!processor.setBusesLayout(layout)) {
+            result.error = "unsupported channel count " + juce::String(numChannels);
+            return result;
+        }
+        processor.setNonRealtime(true);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+        processor.profiler.reset();
+        const auto latency = static_cast<juce::int64>(processor.getLatencySamples());
+
+        auto format = formats.findFormatForFileExtension(output.getFileExtension());
+        if (format == nullptr) {
+            result.error = "can't write " + output.getFullPathName();
+            return result;
+        }
+        output.getParentDirectory().createDirectory();
+        output.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(output.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        if (stream != nullptr)
+            writer.reset(format->createWriterFor(stream.get(), sampleRate, static_cast<unsigned int>(numChannels),
+                getBitDepth(*format, static_cast<int>(reader->bitsPerSample)), reader->metadataValues, 0));
+        if (writer == nullptr) {
+            result.error = "can't write " + output.getFullPathName();
+            return result;
+        }
+        stream.release();
+
+        // the first latency samples of the output get dropped, silence
+        // appended to the input pushes its tail out
+        juce::AudioBuffer<float> buffer(numChannels, blockSize);
+        juce::MidiBuffer midi;
+        auto point = automation.begin();
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        for (juce::int64 pos = 0; pos < length + latency; pos += blockSize) {
+            const auto numSamples = static_cast<int>(juce::jmin(static_cast<juce::int64>(blockSize), length + latency - pos));
+            buffer.clear();
+            if (pos < length)
+                reader->read(&buffer, 0, static_cast<int>(juce::jmin(static_cast<juce::int64>(numSamples), length - pos)), pos, true, true);
+
+            // the queue holds a few hundred events per block, the rest wait for the next
+            for (; point != automation.end(); ++point) {
+                const auto offset = static_cast<juce::int64>(std::round(point->seconds * sampleRate)) - pos;
+                if (offset >= numSamples || !processor.automation.add(point->id, point->value, static_cast<int>(offset)))
+                    break;
+            }
+
+            juce::AudioBuffer<float> block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+            processor.processBlock(block, midi);
+
+            const auto skip = static_cast<int>(juce::jlimit(static_cast<juce::int64>(0), static_cast<juce::int64>(numSamples), latency - pos));
+            if (!writer->writeFromAudioSampleBuffer(block, skip, numSamples - skip)) {
+                result.error = "write failed " + output.getFullPathName();
+                if (output.hasFileExtension(".sqb"))
+                    result.error << ", the output isn't fully squashed";
+                return result;
+            }
+        }
+        // the last of the packed chunks only gets written here
+        if (auto packedWriter = dynamic_cast<packed::Writer*>(writer.get()))
+            if (!packedWriter->flush()) {
+                result.error = "write failed " + output.getFullPathName() + ", the output isn't fully squashed";
+                return result;
+            }
+        result.seconds = (juce::Time::getMillisecondCounterHiRes() - start) * .001;
+        result.profile = processor.profiler.getSnapshot();
+        result.numSamples = length;
+        result.numChannels = numChannels;
+        result.sampleRate = sampleRate;
+        return result;
+    }
+
+    inline juce::String applyParameters(SusquashAudioProcessor& processor, const Settings& settings)
+    {
+        if (settings.state.getSize() > 0)
+            processor.setStateInformation(settings.state.getData(), static_cast<int>(settings.state.getSize()));
+        for (const auto& id : settings.params.getAllKeys()) {
+            auto param = processor.apvts.getParameter(id);
+            if (param == nullptr)
+                return "unknown parameter " + id;
+            param->setValueNotifyingHost(param->convertTo0to1(settings.params[id].getFloatValue()));
+        }
+        return {};
+    }
+
+    // one entry per input file, load in real time budgets
+    inline bool writeProfile(const Settings& settings, const std::vector<Result>& results)
+    {
+        juce::Array<juce::var> files;
+        for (size_t i = 0; i < results.size(); ++i) {
+            juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+            obj->setProperty("file", settings.inputs[static_cast<int>(i)].getFullPathName());
+            obj->setProperty("error", results[i].error);
+            obj->setProperty("load", results[i].profile.toJSON());
+            files.add(juce::var(obj.get()));
+        }
+        juce::DynamicObject::Ptr root = new juce::DynamicObject();
+        root->setProperty("blockSize", settings.blockSize);
+        root->setProperty("isa", dsp::toString(dsp::getISA()));
+        root->setProperty("files", files);
+        return settings.profile.replaceWithText(juce::JSON::toString(juce::var(root.get())));
+    }
+
+    inline int run(const Settings& settings)
+    {
+        const auto numThreads = juce::jmin(settings.numThreads, settings.inputs.size());
+
+        // processors are made here on the main thread and handed to the jobs
+        std::vector<std::unique_ptr<SusquashAudioProcessor>> processors;
+        std::vector<SusquashAudioProcessor*> idle;
+        for (auto i = 0; i < numThreads; ++i) {
+            processors.push_back(std::make_unique<SusquashAudioProcessor>());
+            const auto error = applyParameters(*processors.back(), settings);
+            if (error.isNotEmpty()) {
+                std::cerr << error << "\n";
+                return 1;
+            }
+            idle.push_back(processors.back().get());
+        }
+
+        std::mutex mutex;
+        std::vector<Result> results(static_cast<size_t>(settings.inputs.size()));
+        const auto start = juce::Time::getMillisecondCounterHiRes();
+        {
+            juce::ThreadPool pool(numThreads);
+            for (auto i = 0; i < settings.inputs.size(); ++i) {
+                pool.addJob([&, i]() {
+                    SusquashAudioProcessor* processor;
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        processor = idle.back();
+                        idle.pop_back();
+                    }
+                    const auto& input = settings.inputs.getReference(i);
+                    auto& result = results[static_cast<size_t>(i)];
+                    result = renderFile(*processor, input, getOutputFile(input, settings), settings.blockSize, settings.automation);
+
+                    std::lock_guard<std::mutex> lock(mutex);
+                    idle.push_back(processor);
+                    if (result.error.isNotEmpty())
+                        std::cerr << result.error << "\n";
+                    else
+                        std::cout << input.getFileName() << ": " << result.numSamples << " samples, "
+                            << juce::String(result.numSamples / juce::jmax(result.seconds, 1e-9), 0) << " samples/s\n";
+                });
+            }
+            // the pool's destructor would cancel the jobs still waiting
+            while (pool.getNumJobs() > 0)
+                juce::Thread::sleep(10);
+        }
+        const auto seconds = (juce::Time::getMillisecondCounterHiRes() - start) * .001;
+
+        auto numFailed = 0;
+        juce::int64 numSamples = 0;
+        auto audioSeconds = 0.;
+        for (const auto& result : results) {
+            if (result.error.isNotEmpty())
+                ++numFailed;
+            numSamples += result.numSamples * result.numChannels;
+            if (result.sampleRate > 0.)
+                audioSeconds += static_cast<double>(result.numSamples) / result.sampleRate;
+        }
+        std::cout << results.size() - static_cast<size_t>(numFailed) << " of " << results.size() << " files in "
+            << juce::String(seconds, 2) << " s on " << numThreads << " threads, "
+            << juce::String(numSamples / juce::jmax(seconds, 1e-9), 0) << " samples/s over all channels, "
+            << juce::String(audioSeconds / juce::jmax(seconds, 1e-9), 1) << "x realtime\n";
+        if (settings.profile != juce::File() && !writeProfile(settings, results)) {
+            std::cerr << "can't write " << settings.profile.getFullPathName() << "\n";
+            return 1;
+        }
+        return numFailed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // the processor's parameters expect a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::StringArray args;
+    for (auto i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+    if (args.isEmpty() || args.contains("-h") || args.contains("--help")) {
+        render::printUsage();
+        return args.isEmpty() ? 1 : 0;
+    }
+
+    render::Settings settings;
+    const auto error = render::parseArgs(args, settings);
+    if (error.isNotEmpty()) {
+        std::cerr << error << "\n";
+        render::printUsage();
+        return 1;
+    }
+    return render::run(settings);
+}
@@ -0,0 +1,243 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../../Source/PluginProcessor.h"
+
+// times SusquashAudioProcessor::processBlock in ns per sample over block
+// sizes, channel counts and parameter states, with warm and cold caches.
+// prints json, so results of two revisions can be diffed.
+
+#ifndef SUSQUASH_GIT_REVISION
+ #define SUSQUASH_GIT_REVISION "unknown"
+#endif
+
+namespace bench
+{
+    static constexpr double SampleRate = 48000.;
+    // big enough to push the processor's buffers out of every cache level
+    static constexpr size_t EvictSize = 64 << 20;
+
+    struct Case
+    {
+        int blockSize, numChannels;
+        float squash;
+        bool automated, cold;
+    };
+
+    struct Settings
+    {
+        std::vector<int> blockSizes { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096, 8192 };
+        std::vector<int> channelCounts { 1, 2, 8 };
+        std::vector<float> squashValues { 0.f, 50.f, 100.f };
+        juce::StringPairArray params;
+        juce::File output;
+        int repetitions = 7;
+        // per repetition and channel, warm runs
+        int numSamples = 1 << 18;
+    };
+
+    inline void printUsage()
+    {
+        std::cout <<
+            "usage: susquash-bench [options]\n"
+            "  -o, --output <file>  write the json there instead of stdout\n"
+            "  --set <id>=<value>   parameter value for every case, e.g. --set antialias=1\n"
+            "  --quick              fewer block sizes and repetitions\n";
+    }
+
+    inline juce::String parseArgs(const juce::StringArray& args, Settings& settings)
+    {
+        for (auto i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if ((arg == "-o" || arg == "--output") && hasValue)
+                settings.output = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--set" && hasValue) {
+                const auto pair = args[++i];
+                if (!pair.containsChar('='))
+                    return "--set expects <id>=<value>, got " + pair;
+                settings.params.set(pair.upToFirstOccurrenceOf("=", false, false).trim(),
+                    pair.fromFirstOccurrenceOf("=", false, false).trim());
+            }
+            else if (arg == "--quick") {
+                settings.blockSizes = { 16, 256, 8192 };
+                settings.repetitions = 3;
+                settings.numSamples = 1 << 16;
+            }
+            else
+                return "unknown option " + arg;
+        }
+        return {};
+    }
+
+    inline void setParameter(SusquashAudioProcessor& processor, const juce::String& id, float value)
+    {
+        auto param = processor.apvts.getParameter(id);
+        param->setValueNotifyingHost(param->convertTo0to1(value));
+    }
+
+    struct Runner
+    {
+        Runner(const Settings& _settings) :
+            settings(_settings),
+            evict(EvictSize, 0),
+            noise()
+        {
+            // -6 db white noise, the same for every run
+            juce::Random rand(1);
+            const auto maxBlockSize = *std::max_element(settings.blockSizes.begin(), settings.blockSizes.end());
+            noise.resize(static_cast<size_t>(maxBlockSize));
+            for (auto& x : noise)
+                x = (rand.nextFloat() * 2.f - 1.f) * .5f;
+        }
+
+        // ns per sample of every repetition. profile: the processor's own
+        // measurement of the same blocks
+        std::vector<double> run(const Case& c, dsp::Profiler::Snapshot& profile)
+        {
+            SusquashAudioProcessor processor;
+            for (const auto& id : settings.params.getAllKeys())
+                setParameter(processor, id, settings.params[id].getFloatValue());
+            setParameter(processor, param::getID(param::ID::Squash), c.squash);
+
+            juce::AudioProcessor::BusesLayout layout;
+            layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+            layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(c.numChannels));
+            processor.setBusesLayout(layout);
+            processor.setRateAndBufferSizeDetails(SampleRate, c.blockSize);
+            processor.prepareToPlay(SampleRate, c.blockSize);
+
+            juce::AudioBuffer<float> buffer(c.numChannels, c.blockSize);
+            juce::MidiBuffer midi;
+            // automation moves squash by 10 % every block, so it's always ramping
+            const auto automatedSquash = c.squash < 50.f ? c.squash + 10.f : c.squash - 10.f;
+            // cold runs evict the caches before every block, which is slow, so they do fewer
+            const auto numBlocks = c.cold
+                ? 64
+                : juce::jmax(16, settings.numSamples / c.blockSize);
+
+            std::vector<double> nsPerSample;
+            for (auto r = -1; r < settings.repetitions; ++r) {
+                if (r == 0)
+                    processor.profiler.reset();
+                juce::int64 ticks = 0;
+                for (auto b = 0; b < numBlocks; ++b) {
+                    if (c.automated)
+                        setParameter(processor, param::getID(param::ID::Squash), b % 2 == 0 ? automatedSquash : c.squash);
+                    for (auto ch = 0; ch < c.numChannels; ++ch)
+                        buffer.copyFrom(ch, 0, noise.data(), c.blockSize);
+                    if (c.cold)
+                        evictCaches();
+
+                    const auto start = juce::Time::getHighResolutionTicks();
+                    processor.processBlock(buffer, midi);
+                    ticks += juce::Time::getHighResolutionTicks() - start;
+                }
+                // the first repetition only warms up
+                if (r >= 0)
+                    nsPerSample.push_back(juce::Time::highResolutionTicksToSeconds(ticks) * 1e9
+                        / (static_cast<double>(numBlocks) * c.blockSize * c.numChannels));
+            }
+            profile = processor.profiler.getSnapshot();
+            processor.releaseResources();
+            return nsPerSample;
+        }
+
+    protected:
+        const Settings& settings;
+        std::vector<char> evict;
+        std::vector<float> noise;
+
+        void evictCaches() noexcept
+        {
+            for (size_t i = 0; i < evict.size(); i += 64)
+                ++evict[i];
+        }
+    };
+
+    inline juce::var toJSON(const Case& c, std::vector<double> nsPerSample, const dsp::Profiler::Snapshot& profile)
+    {
+        std::sort(nsPerSample.begin(), nsPerSample.end());
+        juce::DynamicObject::Ptr obj = new juce::DynamicObject();
+        obj->setProperty("blockSize", c.blockSize);
+        obj->setProperty("numChannels", c.numChannels);
+        obj->setProperty("squash", c.squash);
+        obj->setProperty("automated", c.automated);
+        obj->setProperty("cache", c.cold ? "cold" : "warm");
+        obj->setProperty("nsPerSample", nsPerSample[nsPerSample.size() / 2]);
+        obj->setProperty("nsPerSampleMin", nsPerSample.front());
+        obj->setProperty("nsPerSampleMax", nsPerSample.back());
+        // what the processor's profiler measured, in real time budgets
+        obj->setProperty("load", profile.toJSON());
+        return juce::var(obj.get());
+    }
+
+    inline int run(const Settings& settings)
+    {
+        {
+            SusquashAudioProcessor processor;
+            for (const auto& id : settings.params.getAllKeys())
+                if (processor.apvts.getParameter(id) == nullptr) {
+                    std::cerr << "unknown parameter " << id << "\n";
+                    return 1;
+                }
+        }
+
+        Runner runner(settings);
+        juce::Array<juce::var> results;
+        for (auto cold : { false, true })
+            for (auto numChannels : settings.channelCounts)
+                for (auto squash : settings.squashValues)
+                    for (auto automated : { false, true })
+                        for (auto blockSize : settings.blockSizes) {
+                            const Case c { blockSize, numChannels, squash, automated, cold };
+                            dsp::Profiler::Snapshot profile;
+                            const auto nsPerSample = runner.run(c, profile);
+                            results.add(toJSON(c, nsPerSample, profile));
+                            std::cerr << "." << std::flush;
+                        }
+        std::cerr << "\n";
+
+        juce::DynamicObject::Ptr params = new juce::DynamicObject();
+        for (const auto& id : settings.params.getAllKeys())
+            params->setProperty(id, settings.params[id].getFloatValue());
+
+        juce::DynamicObject::Ptr root = new juce::DynamicObject();
+        root->setProperty("revision", SUSQUASH_GIT_REVISION);
+        root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("isa", dsp::toString(dsp::getISA()));
+        root->setProperty("sampleRate", SampleRate);
+        root->setProperty("params", juce::var(params.get()));
+        root->setProperty("results", results);
+        const auto json = juce::JSON::toString(juce::var(root.get()));
+
+        if (settings.output == juce::File()) {
+            std::cout << json << "\n";
+            return 0;
+        }
+        return settings.output.replaceWithText(json) ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // the processor's parameters expect a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::StringArray args;
+    for (auto i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+    if (args.contains("-h") || args.contains("--help")) {
+        bench::printUsage();
+        return 0;
+    }
+
+    bench::Settings settings;
+    const auto error = bench::parseArgs(args, settings);
+    if (error.isNotEmpty()) {
+        std::cerr << error << "\n";
+        bench::printUsage();
+        return 1;
+    }
+    return bench::run(settings);
+}
@@ -0,0 +1,336 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include <set>
+#include "../../../Source/PackedFormat.h"
+
+// checks what the kernels compute against plain reference code, for
+// float and double on every isa this cpu has, and the .sqb format built
+// on the pack kernels. ctest runs each check on its own, see
+// CMakeLists.txt. exits with 1 if anything is off
+
+namespace kernelcheck
+{
+    template<typename T>
+    const char* getTypeName() noexcept { return std::is_same<T, float>::value ? "float" : "double"; }
+
+    // largest relative (or absolute) difference of out to ref
+    inline double getError(const std::vector<double>& out, const std::vector<long double>& ref, bool relative)
+    {
+        auto worst = 0.;
+        for (size_t i = 0; i < out.size(); ++i) {
+            const auto e = std::abs(static_cast<long double>(out[i]) - ref[i]);
+            worst = std::max(worst, static_cast<double>(relative ? e / std::abs(ref[i]) : e));
+        }
+        return worst;
+    }
+
+    inline bool report(const juce::String& what, double error, double bound)
+    {
+        const auto ok = error < bound;
+        std::cout << what << ": " << error << (ok ? " < " : " >= ") << bound << (ok ? "" : " FAILED") << "\n";
+        return ok;
+    }
+
+    inline bool expect(const juce::String& what, bool ok)
+    {
+        std::cout << what << (ok ? "" : " FAILED") << "\n";
+        return ok;
+    }
+
+    // the bounds Squash.h documents for dbToGain and the tanh curves, over
+    // their documented ranges. dbToGain in double is exp2Vec's polynomial,
+    // rounding barely adds to it there
+    template<typename T>
+    bool accuracy(dsp::ISA isa)
+    {
+        static constexpr int NumPoints = 1 << 20;
+        const auto& k = dsp::getKernels<T>(isa);
+        const auto prefix = dsp::toString(isa) + ", " + getTypeName<T>() + ": ";
+        const auto isFloat = std::is_same<T, float>::value;
+        std::vector<T> in(NumPoints), buf(NumPoints);
+        std::vector<double> out(NumPoints);
+        std::vector<long double> ref(NumPoints);
+        auto ok = true;
+
+        for (auto i = 0; i < NumPoints; ++i) {
+            in[i] = buf[i] = static_cast<T>(-64. + 88. * i / (NumPoints - 1));
+            ref[i] = std::pow(10.L, static_cast<long double>(in[i]) / 20.L);
+        }
+        k.dbToGain(buf.data(), NumPoints);
+        std::copy(buf.begin(), buf.end(), out.begin());
+        ok = report(prefix + "dbToGain", getError(out, ref, true), isFloat ? 6e-7 : 1.7e-7) && ok;
+
+        for (auto curve : { dsp::Curve::Soft, dsp::Curve::Asymmetric }) {
+            for (auto i = 0; i < NumPoints; ++i) {
+                in[i] = static_cast<T>(-20. + 40. * i / (NumPoints - 1));
+                const auto u = static_cast<long double>(in[i]) * (curve == dsp::Curve::Asymmetric && in[i] < T(0) ? 4.L : 1.L);
+                ref[i] = std::tanh(u);
+            }
+            k.shape[static_cast<int>(curve)](in.data(), buf.data(), NumPoints, T(1));
+            std::copy(buf.begin(), buf.end(), out.begin());
+            ok = report(prefix + (curve == dsp::Curve::Soft ? "soft" : "asymmetric"),
+                getError(out, ref, false), isFloat ? 1.5e-7 : 8e-8) && ok;
+        }
+        return ok;
+    }
+
+    // the hysteresis state machine the way it reads, with branches, for one channel
+    template<typename T>
+    struct HysteresisModel
+    {
+        T y = T(0), wait = T(0), quiet = T(0);
+
+        T operator()(T x, T threshold, T holdSamples, T releaseSamples) noexcept
+        {
+            const auto past = std::abs(x) > threshold;
+            quiet = past ? T(0) : std::min(quiet + T(1), releaseSamples);
+            auto wanted = y;
+            if (past)
+                wanted = x > T(0) ? T(1) : T(-1);
+            else if (quiet >= releaseSamples)
+                wanted = T(0);
+            wait = std::max(wait - T(1), T(0));
+            if (wait == T(0) && wanted != y) {
+                y = wanted;
+                wait = holdSamples;
+            }
+            return y;
+        }
+    };
+
+    // the kernel has to match the model exactly. channels get interleaved
+    // into groups of lanes like Engine::holdSigns does, so counts that
+    // don't fill the last group leave silent lanes. blocks of varying
+    // length carry the state over
+    template<typename T>
+    bool hysteresis(dsp::ISA isa)
+    {
+        static constexpr int NumSamples = 20000;
+        struct Settings { T threshold, holdSamples, releaseSamples; };
+        const Settings settings[] = { { T(.002), T(7), T(300) }, { T(0), T(3), T(50) }, { T(.01), T(1), T(1) } };
+        const auto& k = dsp::getKernels<T>(isa);
+        const auto lanes = k.lanes;
+        auto ok = true;
+
+        for (auto numChannels : std::set<int> { 1, 3, lanes + 1, 2 * lanes - 1 }) {
+            // a quiet sine per channel with noise on it, then the noise alone
+            juce::Random rand(numChannels);
+            std::vector<std::vector<T>> in(static_cast<size_t>(numChannels), std::vector<T>(NumSamples));
+            for (auto ch = 0; ch < numChannels; ++ch)
+                for (auto s = 0; s < NumSamples; ++s) {
+                    const auto signal = s < NumSamples * 3 / 4 ? .01 * (1 + ch % 3) * std::sin(s * .01 * (ch + 1)) : 0.;
+                    in[ch][s] = static_cast<T>(signal + .002 * (rand.nextDouble() * 2. - 1.));
+                }
+
+            for (const auto& set : settings) {
+                const auto numGroups = (numChannels + lanes - 1) / lanes;
+                std::vector<T> frames(static_cast<size_t>(lanes * NumSamples));
+                std::vector<T> state(static_cast<size_t>(3 * lanes * numGroups), T(0));
+                std::vector<HysteresisModel<T>> models(static_cast<size_t>(numChannels));
+                auto numWrong = 0, numTurns = 0;
+                for (auto start = 0, block = 1; start < NumSamples; start += block, block = block * 3 % 1021 + 1) {
+                    const auto n = std::min(block, NumSamples - start);
+                    for (auto group = 0; group < numGroups; ++group) {
+                        for (auto lane = 0; lane < lanes; ++lane) {
+                            const auto ch = group * lanes + lane;
+                            for (auto s = 0; s < n; ++s)
+                                frames[s * lanes + lane] = ch < numChannels ? in[ch][start + s] : T(0);
+                        }
+                        k.hysteresis(frames.data(), frames.data(), n, set.threshold, set.holdSamples, set.releaseSamples,
+                            state.data() + 3 * group * lanes);
+                        for (auto lane = 0; lane < lanes && group * lanes + lane < numChannels; ++lane) {
+                            auto& model = models[group * lanes + lane];
+                            for (auto s = 0; s < n; ++s) {
+                                const auto y = model.y;
+                                const auto expected = model(in[group * lanes + lane][start + s],
+                                    set.threshold, set.holdSamples, set.releaseSamples);
+                                numTurns += expected != y;
+                                numWrong += frames[s * lanes + lane] != expected;
+                            }
+                        }
+                    }
+                }
+                const auto passed = numWrong == 0 && numTurns > 0;
+                std::cout << dsp::toString(isa) << ", " << getTypeName<T>() << ", " << numChannels << " ch, threshold "
+                    << set.threshold << ", hold " << set.holdSamples << ": " << numWrong << " wrong of "
+                    << numChannels * NumSamples << ", " << numTurns << " turns" << (passed ? "" : " FAILED") << "\n";
+                ok = passed && ok;
+            }
+        }
+        return ok;
+    }
+
+    static constexpr int SqbChannels = 2, SqbFlushAt = 40000, SqbLastChunk = 1234,
+        SqbSamples = SqbFlushAt + 2 * packed::ChunkSize + SqbLastChunk;
+
+    // runs of gain, -gain and 0, long and short, so every kind of record
+    // comes up. the gain changes where flush() ends the first chunk
+    inline std::vector<std::vector<float>> makeSqbSignal()
+    {
+        juce::Random rand(SqbSamples);
+        std::vector<std::vector<float>> signal(SqbChannels, std::vector<float>(SqbSamples));
+        for (auto& channel : signal)
+            for (auto s = 0; s < SqbSamples;) {
+                const auto n = std::min(rand.nextInt(4) == 0 ? 1 + rand.nextInt(5000) : 1 + rand.nextInt(100), SqbSamples - s);
+                const auto kind = rand.nextInt(4);
+                for (auto end = s + n; s < end; ++s) {
+                    const auto gain = s < SqbFlushAt ? .5f : .125f;
+                    channel[static_cast<size_t>(s)] = kind == 0 ? 0.f : kind == 1 ? -gain : gain;
+                }
+            }
+        return signal;
+    }
+
+    // in blocks of varying length, with a flush() at SqbFlushAt
+    inline bool writeSqb(const std::vector<std::vector<float>>& signal, juce::MemoryBlock& file)
+    {
+        packed::Format format;
+        std::unique_ptr<juce::AudioFormatWriter> writer(format.createWriterFor(new juce::MemoryOutputStream(file, false),
+            48000., static_cast<unsigned int>(SqbChannels), 32, {}, 0));
+        if (writer == nullptr)
+            return false;
+        for (auto start = 0, block = 1; start < SqbSamples; start += block, block = block * 7 % 4099 + 1) {
+            block = std::min(block, (start < SqbFlushAt ? SqbFlushAt : SqbSamples) - start);
+            const float* channels[SqbChannels];
+            for (auto ch = 0; ch < SqbChannels; ++ch)
+                channels[ch] = signal[static_cast<size_t>(ch)].data() + start;
+            if (!writer->writeFromFloatArrays(channels, SqbChannels, block))
+                return false;
+            if (start + block == SqbFlushAt && !writer->flush())
+                return false;
+        }
+        return true;
+    }
+
+    inline std::unique_ptr<juce::AudioFormatReader> readSqb(const juce::MemoryBlock& file)
+    {
+        packed::Format format;
+        return std::unique_ptr<juce::AudioFormatReader>(format.createReaderFor(new juce::MemoryInputStream(file, false), true));
+    }
+
+    // where the chunks start, and how many samples they have
+    inline std::vector<std::pair<size_t, int>> getSqbChunks(const juce::MemoryBlock& file)
+    {
+        std::vector<std::pair<size_t, int>> chunks;
+        const auto data = static_cast<const juce::uint8*>(file.getData());
+        for (auto pos = packed::HeaderSize; pos + packed::ChunkHeaderSize <= file.getSize();
+            pos += packed::read<juce::uint32>(data + pos))
+            chunks.push_back({ pos, static_cast<int>(packed::read<juce::uint32>(data + pos + 4)) });
+        return chunks;
+    }
+
+    // file with a chunk header field changed, size at offset 0, samples at 4
+    inline juce::MemoryBlock corruptSqb(const juce::MemoryBlock& file, size_t pos, int delta)
+    {
+        juce::MemoryBlock corrupted(file);
+        auto field = static_cast<juce::uint8*>(corrupted.getData()) + pos;
+        packed::write(field, static_cast<juce::uint32>(static_cast<int>(packed::read<juce::uint32>(field)) + delta));
+        return corrupted;
+    }
+
+    // the format in memory: what gets written reads back sample for sample,
+    // flush() ends a chunk where it's called, and files that are cut short
+    // or have a chunk header that doesn't add up don't open
+    inline bool sqb()
+    {
+        const auto signal = makeSqbSignal();
+        juce::MemoryBlock file;
+        auto ok = expect("write " + juce::String(SqbSamples) + " samples with a flush() at " + juce::String(SqbFlushAt),
+            writeSqb(signal, file));
+        if (!ok)
+            return false;
+
+        const auto chunks = getSqbChunks(file);
+        std::vector<int> sizes;
+        for (const auto& chunk : chunks)
+            sizes.push_back(chunk.second);
+        ok = expect(juce::String(static_cast<int>(chunks.size())) + " chunks of " + juce::String(SqbFlushAt) + ", "
+            + juce::String(packed::ChunkSize) + " twice and " + juce::String(SqbLastChunk),
+            sizes == std::vector<int> { SqbFlushAt, packed::ChunkSize, packed::ChunkSize, SqbLastChunk }) && ok;
+
+        if (auto reader = readSqb(file)) {
+            ok = expect("opens with " + juce::String(reader->lengthInSamples) + " samples",
+                reader->lengthInSamples == SqbSamples && reader->numChannels == SqbChannels && reader->sampleRate == 48000.) && ok;
+            juce::AudioBuffer<float> buffer(SqbChannels, 5000);
+            auto numWrong = 0;
+            for (auto start = 0, block = 1; start < SqbSamples; start += block, block = block * 5 % 4999 + 1) {
+                block = std::min(block, SqbSamples - start);
+                reader->read(&buffer, 0, block, start, true, true);
+                for (auto ch = 0; ch < SqbChannels; ++ch)
+                    for (auto s = 0; s < block; ++s)
+                        numWrong += buffer.getSample(ch, s) != signal[static_cast<size_t>(ch)][static_cast<size_t>(start + s)];
+            }
+            ok = expect("reads back with " + juce::String(numWrong) + " wrong samples", numWrong == 0) && ok;
+        }
+        else
+            ok = expect("opens", false);
+
+        juce::MemoryBlock cut(file.getData(), chunks.back().first), cutMid(file.getData(), file.getSize() - 5);
+        ok = expect("doesn't open without its last chunk", readSqb(cut) == nullptr) && ok;
+        ok = expect("doesn't open cut in the last chunk", readSqb(cutMid) == nullptr) && ok;
+        ok = expect("doesn't open with a chunk's size off by one", readSqb(corruptSqb(file, chunks[1].first, 1)) == nullptr) && ok;
+        ok = expect("doesn't open with a chunk's samples off by one", readSqb(corruptSqb(file, chunks[1].first + 4, -1)) == nullptr) && ok;
+        return ok;
+    }
+
+    // check(isa, T()) for float and double on every isa
+    template<typename F>
+    bool forEachISA(F check)
+    {
+        auto ok = true;
+        for (auto i = 0; i <= static_cast<int>(dsp::getISA()); ++i) {
+            ok = check(static_cast<dsp::ISA>(i), 0.f) && ok;
+            ok = check(static_cast<dsp::ISA>(i), 0.) && ok;
+        }
+        return ok;
+    }
+
+    struct Check
+    {
+        const char* name;
+        bool(*run)();
+    };
+
+    inline std::vector<Check> getChecks()
+    {
+        return {
+            { "accuracy", [] { return forEachISA([](dsp::ISA isa, auto t) { return accuracy<decltype(t)>(isa); }); } },
+            { "hysteresis", [] { return forEachISA([](dsp::ISA isa, auto t) { return hysteresis<decltype(t)>(isa); }); } },
+            { "sqb", [] { return sqb(); } }
+        };
+    }
+
+    inline void printUsage()
+    {
+        std::cout << "usage: susquash-kernelcheck [check...], all of them if none. checks:\n";
+        for (const auto& check : getChecks())
+            std::cout << "  " << check.name << "\n";
+    }
+
+    inline int run(const juce::StringArray& names)
+    {
+        auto failed = 0;
+        for (const auto& check : getChecks())
+            if (names.isEmpty() || names.contains(check.name)) {
+                std::cout << check.name << "\n";
+                failed += check.run() ? 0 : 1;
+            }
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray names;
+    for (auto i = 1; i < argc; ++i)
+        names.add(juce::String::fromUTF8(argv[i]));
+    for (const auto& name : names) {
+        const auto checks = kernelcheck::getChecks();
+        const auto known = std::any_of(checks.begin(), checks.end(), [&](const kernelcheck::Check& c) { return name == c.name; });
+        if (!known) {
+            kernelcheck::printUsage();
+            return name == "-h" || name == "--help" ? 0 : 1;
+        }
+    }
+    return kernelcheck::run(names);
+}
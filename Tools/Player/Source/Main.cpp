@@ -0,0 +1,164 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../../Source/PackedFormat.h"
+
+// plays .sqb files as susquash-render wrote them, or expands them back into
+// wav, aiff or flac. the bits become samples in the simd unpack kernel of
+// the widest isa this cpu has
+
+namespace play
+{
+    struct Settings
+    {
+        juce::File input, output;
+        bool bench = false;
+    };
+
+    inline void printUsage()
+    {
+        std::cout <<
+            "usage: susquash-play [options] <file.sqb>\n"
+            "  -o, --output <file>  write wav, aiff or flac there instead of playing\n"
+            "  --bench              time the decoder on the whole file, print samples/s\n";
+    }
+
+    inline juce::String parseArgs(const juce::StringArray& args, Settings& settings)
+    {
+        for (auto i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if ((arg == "-o" || arg == "--output") && hasValue)
+                settings.output = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else if (arg == "--bench")
+                settings.bench = true;
+            else if (arg.startsWith("-"))
+                return "unknown option " + arg;
+            else
+                settings.input = juce::File::getCurrentWorkingDirectory().getChildFile(arg);
+        }
+        if (!settings.input.existsAsFile())
+            return "no such file " + settings.input.getFullPathName();
+        return {};
+    }
+
+    inline int bench(juce::AudioFormatReader& reader)
+    {
+        static constexpr int BlockSize = 1 << 16, Repetitions = 5;
+        const auto numChannels = static_cast<int>(reader.numChannels);
+        juce::AudioBuffer<float> buffer(numChannels, BlockSize);
+        auto best = std::numeric_limits<double>::max();
+        for (auto r = 0; r < Repetitions; ++r) {
+            const auto start = juce::Time::getHighResolutionTicks();
+            for (juce::int64 pos = 0; pos < reader.lengthInSamples; pos += BlockSize)
+                if (!reader.read(&buffer, 0, static_cast<int>(juce::jmin(static_cast<juce::int64>(BlockSize), reader.lengthInSamples - pos)), pos, true, true)) {
+                    std::cerr << "can't decode\n";
+                    return 1;
+                }
+            best = juce::jmin(best, juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+        }
+        std::cout << reader.lengthInSamples << " samples, " << numChannels << " channels, "
+            << dsp::toString(dsp::getISA()) << ": "
+            << juce::String(static_cast<double>(reader.lengthInSamples * numChannels) / juce::jmax(best, 1e-9), 0)
+            << " samples/s\n";
+        return 0;
+    }
+
+    inline int convert(juce::AudioFormatManager& formats, juce::AudioFormatReader& reader, const juce::File& output)
+    {
+        auto format = formats.findFormatForFileExtension(output.getFileExtension());
+        if (format == nullptr || dynamic_cast<packed::Format*>(format) != nullptr) {
+            std::cerr << "can't write " << output.getFullPathName() << "\n";
+            return 1;
+        }
+        output.deleteFile();
+        std::unique_ptr<juce::OutputStream> stream(output.createOutputStream());
+        std::unique_ptr<juce::AudioFormatWriter> writer;
+        // float where the format has it, 24 bit holds gain, -gain and 0 as well
+        const auto depths = format->getPossibleBitDepths();
+        if (stream != nullptr)
+            writer.reset(format->createWriterFor(stream.get(), reader.sampleRate, reader.numChannels,
+                depths.contains(32) ? 32 : depths.getLast(), {}, 0));
+        if (writer == nullptr) {
+            std::cerr << "can't write " << output.getFullPathName() << "\n";
+            return 1;
+        }
+        stream.release();
+        if (!writer->writeFromAudioReader(reader, 0, reader.lengthInSamples)) {
+            std::cerr << "write failed " << output.getFullPathName() << "\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    // the default output device, resampled to its rate, with the file read
+    // ahead on a thread of its own
+    inline int play(juce::AudioFormatReader& reader)
+    {
+        const auto numChannels = static_cast<int>(reader.numChannels);
+        juce::AudioDeviceManager devices;
+        const auto error = devices.initialiseWithDefaultDevices(0, numChannels);
+        if (error.isNotEmpty() || devices.getCurrentAudioDevice() == nullptr) {
+            std::cerr << "no audio device " << error << "\n";
+            return 1;
+        }
+
+        juce::TimeSliceThread readAhead("susquash-play read ahead");
+        readAhead.startThread();
+        juce::AudioFormatReaderSource source(&reader, false);
+        juce::AudioTransportSource transport;
+        transport.setSource(&source, 1 << 15, &readAhead, reader.sampleRate, numChannels);
+        juce::AudioSourcePlayer player;
+        player.setSource(&transport);
+        devices.addAudioCallback(&player);
+
+        transport.start();
+        std::cout << "playing " << juce::String(transport.getLengthInSeconds(), 1) << " s\n";
+        while (transport.isPlaying() && !transport.hasStreamFinished())
+            juce::Thread::sleep(50);
+
+        devices.removeAudioCallback(&player);
+        player.setSource(nullptr);
+        transport.setSource(nullptr);
+        return 0;
+    }
+
+    inline int run(const Settings& settings)
+    {
+        juce::AudioFormatManager formats;
+        formats.registerFormat(new packed::Format(), false);
+        formats.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formats.createReaderFor(settings.input));
+        if (reader == nullptr || dynamic_cast<packed::Reader*>(reader.get()) == nullptr) {
+            std::cerr << "not a .sqb file " << settings.input.getFullPathName() << "\n";
+            return 1;
+        }
+        if (settings.bench)
+            return bench(*reader);
+        if (settings.output != juce::File())
+            return convert(formats, *reader, settings.output);
+        return play(*reader);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // the audio device wants a message manager
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::StringArray args;
+    for (auto i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+    if (args.isEmpty() || args.contains("-h") || args.contains("--help")) {
+        play::printUsage();
+        return args.isEmpty() ? 1 : 0;
+    }
+
+    play::Settings settings;
+    const auto error = play::parseArgs(args, settings);
+    if (error.isNotEmpty()) {
+        std::cerr << error << "\n";
+        play::printUsage();
+        return 1;
+    }
+    return play::run(settings);
+}
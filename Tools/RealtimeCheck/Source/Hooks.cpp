@@ -0,0 +1,205 @@
+// glibc only: an executable's definitions of libc functions win over libc's
+// own for every caller in the process, juce and the standard library
+// included. the heap goes straight to glibc's allocator through its
+// __libc_ entry points, everything else to the next definition dlsym finds
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include "../../../Source/Realtime.h"
+#include "Hooks.h"
+
+extern "C"
+{
+    void* __libc_malloc(size_t);
+    void* __libc_calloc(size_t, size_t);
+    void* __libc_realloc(void*, size_t);
+    void* __libc_memalign(size_t, size_t);
+    void __libc_free(void*);
+}
+
+namespace rtcheck
+{
+    // more than that is just the same ones again
+    static constexpr int MaxReports = 16;
+
+    static std::atomic<int> numViolations { 0 };
+    static std::atomic<bool> abortOnViolation { false };
+
+    int getNumViolations() noexcept { return numViolations.load(); }
+    void resetViolations() noexcept { numViolations.store(0); }
+    void setAbortOnViolation(bool a) noexcept { abortOnViolation.store(a); }
+
+    static void trap(const char* what) noexcept
+    {
+        if (!dsp::RealtimeScope::isRealtime())
+            return;
+        // reporting allocates and writes, which mustn't count again
+        const dsp::RealtimeScope allowed(false);
+        const auto n = numViolations.fetch_add(1) + 1;
+        if (n <= MaxReports) {
+            std::fprintf(stderr, "realtime violation %d: %s in processBlock\n", n, what);
+            void* frames[32];
+            backtrace_symbols_fd(frames, backtrace(frames, 32), STDERR_FILENO);
+        }
+        if (abortOnViolation.load())
+            std::abort();
+    }
+
+    // resolved on first use into a constant initialised static, so there's
+    // no guard that could lock. dlsym doesn't go through any of these
+    template<typename F>
+    static F next(F& f, const char* name) noexcept
+    {
+        if (f == nullptr)
+            f = reinterpret_cast<F>(dlsym(RTLD_NEXT, name));
+        return f;
+    }
+}
+
+extern "C"
+{
+    void* malloc(size_t size) noexcept
+    {
+        rtcheck::trap("malloc");
+        return __libc_malloc(size);
+    }
+
+    void* calloc(size_t num, size_t size) noexcept
+    {
+        rtcheck::trap("calloc");
+        return __libc_calloc(num, size);
+    }
+
+    void* realloc(void* ptr, size_t size) noexcept
+    {
+        rtcheck::trap("realloc");
+        return __libc_realloc(ptr, size);
+    }
+
+    void free(void* ptr) noexcept
+    {
+        if (ptr != nullptr)
+            rtcheck::trap("free");
+        __libc_free(ptr);
+    }
+
+    void* memalign(size_t alignment, size_t size) noexcept
+    {
+        rtcheck::trap("memalign");
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(size_t alignment, size_t size) noexcept
+    {
+        rtcheck::trap("aligned_alloc");
+        return __libc_memalign(alignment, size);
+    }
+
+    int posix_memalign(void** ptr, size_t alignment, size_t size) noexcept
+    {
+        rtcheck::trap("posix_memalign");
+        if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return 22; // EINVAL
+        *ptr = __libc_memalign(alignment, size);
+        return *ptr == nullptr ? 12 : 0; // ENOMEM
+    }
+
+    int pthread_mutex_lock(pthread_mutex_t* mutex) noexcept
+    {
+        rtcheck::trap("pthread_mutex_lock");
+        static decltype(&::pthread_mutex_lock) real = nullptr;
+        return rtcheck::next(real, "pthread_mutex_lock")(mutex);
+    }
+
+    int pthread_rwlock_rdlock(pthread_rwlock_t* lock) noexcept
+    {
+        rtcheck::trap("pthread_rwlock_rdlock");
+        static decltype(&::pthread_rwlock_rdlock) real = nullptr;
+        return rtcheck::next(real, "pthread_rwlock_rdlock")(lock);
+    }
+
+    int pthread_rwlock_wrlock(pthread_rwlock_t* lock) noexcept
+    {
+        rtcheck::trap("pthread_rwlock_wrlock");
+        static decltype(&::pthread_rwlock_wrlock) real = nullptr;
+        return rtcheck::next(real, "pthread_rwlock_wrlock")(lock);
+    }
+
+    int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
+    {
+        rtcheck::trap("pthread_cond_wait");
+        static decltype(&::pthread_cond_wait) real = nullptr;
+        return rtcheck::next(real, "pthread_cond_wait")(cond, mutex);
+    }
+
+    int pthread_cond_timedwait(pthread_cond_t* cond, pthread_mutex_t* mutex, const timespec* time)
+    {
+        rtcheck::trap("pthread_cond_timedwait");
+        static decltype(&::pthread_cond_timedwait) real = nullptr;
+        return rtcheck::next(real, "pthread_cond_timedwait")(cond, mutex, time);
+    }
+
+    int sem_wait(sem_t* sem)
+    {
+        rtcheck::trap("sem_wait");
+        static decltype(&::sem_wait) real = nullptr;
+        return rtcheck::next(real, "sem_wait")(sem);
+    }
+
+    int nanosleep(const timespec* time, timespec* remaining)
+    {
+        rtcheck::trap("nanosleep");
+        static decltype(&::nanosleep) real = nullptr;
+        return rtcheck::next(real, "nanosleep")(time, remaining);
+    }
+
+    int usleep(useconds_t us)
+    {
+        rtcheck::trap("usleep");
+        static decltype(&::usleep) real = nullptr;
+        return rtcheck::next(real, "usleep")(us);
+    }
+
+    int sched_yield() noexcept
+    {
+        rtcheck::trap("sched_yield");
+        static decltype(&::sched_yield) real = nullptr;
+        return rtcheck::next(real, "sched_yield")();
+    }
+
+    ssize_t read(int fd, void* buf, size_t count)
+    {
+        rtcheck::trap("read");
+        static decltype(&::read) real = nullptr;
+        return rtcheck::next(real, "read")(fd, buf, count);
+    }
+
+    ssize_t write(int fd, const void* buf, size_t count)
+    {
+        rtcheck::trap("write");
+        static decltype(&::write) real = nullptr;
+        return rtcheck::next(real, "write")(fd, buf, count);
+    }
+
+    // futex waits end up in here. no system call takes more than 6 arguments
+    long syscall(long number, ...) noexcept
+    {
+        rtcheck::trap("syscall");
+        va_list args;
+        va_start(args, number);
+        long a[6];
+        for (auto& x : a)
+            x = va_arg(args, long);
+        va_end(args);
+        static decltype(&::syscall) real = nullptr;
+        return rtcheck::next(real, "syscall")(number, a[0], a[1], a[2], a[3], a[4], a[5]);
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// the checker's side of dsp::RealtimeScope. Hooks.cpp replaces libc's heap,
+// lock and system call functions for the whole process. each counts a
+// violation when it's called on a thread inside a RealtimeScope
+namespace rtcheck
+{
+    int getNumViolations() noexcept;
+    void resetViolations() noexcept;
+    // stops at the first violation, for a debugger
+    void setAbortOnViolation(bool) noexcept;
+}
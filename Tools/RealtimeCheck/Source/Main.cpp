@@ -0,0 +1,178 @@
+#include <JuceHeader.h>
+#include <iostream>
+#include "../../../Source/PluginProcessor.h"
+#include "Hooks.h"
+
+// runs SusquashAudioProcessor through every mode it has, while the hooks
+// trap heap, lock and system calls inside processBlock. between blocks the
+// parameters move, automation gets queued and the block size changes, the
+// way a host would do it. exits with 1 if anything got trapped
+
+#if !SUSQUASH_RT_CHECK
+ #error "the processor needs to be built with SUSQUASH_RT_CHECK=1 for the hooks to see it"
+#endif
+
+namespace rtcheck
+{
+    static constexpr double SampleRate = 48000.;
+    static constexpr int BlockSize = 512, NumBlocks = 96;
+
+    struct Config
+    {
+        const char* name;
+        std::vector<std::pair<param::ID, float>> params;
+    };
+
+    inline std::vector<Config> getConfigs()
+    {
+        using ID = param::ID;
+        return {
+            { "default", {} },
+            { "adaa 1", { { ID::AntiAlias, 1.f } } },
+            { "adaa 2", { { ID::AntiAlias, 2.f } } },
+            { "oversampling min phase", { { ID::Oversampling, 2.f } } },
+            { "oversampling linear phase", { { ID::Oversampling, 3.f }, { ID::OversamplingFilter, 1.f } } },
+            { "link", { { ID::Link, 1.f } } },
+            { "soft", { { ID::Curve, 1.f }, { ID::Knee, 20.f } } },
+            { "cubic", { { ID::Curve, 2.f } } },
+            { "asymmetric", { { ID::Curve, 3.f }, { ID::Oversampling, 1.f } } },
+            { "2 bands", { { ID::Bands, 2.f } } },
+            { "4 bands", { { ID::Bands, 4.f }, { ID::Curve, 1.f }, { ID::Oversampling, 2.f } } },
+            { "silence floor", { { ID::SilenceFloor, -60.f } } },
+            { "hysteresis", { { ID::Hysteresis, -40.f }, { ID::Hold, 2.f }, { ID::AntiAlias, 1.f }, { ID::Oversampling, 2.f } } },
+            { "linked hysteresis", { { ID::Hysteresis, -60.f }, { ID::Link, 1.f } } }
+        };
+    }
+
+    // stands in for the plugin wrapper, so anything processBlock tells the
+    // host goes through the listener lock like it would in a host
+    struct HostListener :
+        public juce::AudioProcessorListener
+    {
+        void audioProcessorParameterChanged(juce::AudioProcessor*, int, float) override {}
+        void audioProcessorChanged(juce::AudioProcessor*, const ChangeDetails&) override {}
+    };
+
+    inline void setParameter(SusquashAudioProcessor& processor, param::ID id, float value)
+    {
+        auto param = processor.apvts.getParameter(param::getID(id));
+        param->setValueNotifyingHost(param->convertTo0to1(value));
+    }
+
+    template<typename T>
+    void run(const Config& config, int numChannels)
+    {
+        SusquashAudioProcessor processor;
+        HostListener host;
+        processor.addListener(&host);
+        for (const auto& p : config.params)
+            setParameter(processor, p.first, p.second);
+
+        juce::AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        layout.outputBuses.add(juce::AudioChannelSet::canonicalChannelSet(numChannels));
+        processor.setBusesLayout(layout);
+        processor.setProcessingPrecision(std::is_same<T, double>::value
+            ? juce::AudioProcessor::doublePrecision
+            : juce::AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails(SampleRate, BlockSize);
+        processor.prepareToPlay(SampleRate, BlockSize);
+        processor.scope.setActive(true);
+
+        juce::AudioBuffer<T> buffer(numChannels, BlockSize);
+        juce::MidiBuffer midi;
+        juce::Random rand(1);
+        for (auto b = 0; b < NumBlocks; ++b) {
+            // hosts may send any block size up to the prepared one
+            const auto numSamples = b % 5 == 2 ? 1 + rand.nextInt(BlockSize) : BlockSize;
+            // a stretch of silence, so the idle path runs too
+            const auto silent = b >= NumBlocks / 2 && b < NumBlocks / 2 + 8;
+            for (auto ch = 0; ch < numChannels; ++ch) {
+                auto samples = buffer.getWritePointer(ch);
+                for (auto s = 0; s < numSamples; ++s)
+                    samples[s] = silent ? T(0) : static_cast<T>(rand.nextFloat() * 2.f - 1.f);
+            }
+
+            if (b % 3 == 0) {
+                processor.automation.add(param::ID::Squash, rand.nextFloat() * 100.f, rand.nextInt(numSamples));
+                processor.automation.add(param::ID::Gain, rand.nextFloat() * -12.f, rand.nextInt(numSamples));
+            }
+            if (b % 8 == 4) {
+                setParameter(processor, param::ID::Squash, rand.nextFloat() * 100.f);
+                setParameter(processor, param::ID::Crossover2, 500.f + rand.nextFloat() * 2000.f);
+            }
+            // quality changes mid stream, which also changes the latency
+            if (b == NumBlocks / 4)
+                setParameter(processor, param::ID::Oversampling, 1.f);
+
+            juce::AudioBuffer<T> block(buffer.getArrayOfWritePointers(), numChannels, numSamples);
+            if (b % 16 >= 12)
+                processor.processBlockBypassed(block, midi);
+            else
+                processor.processBlock(block, midi);
+        }
+        processor.releaseResources();
+        processor.removeListener(&host);
+    }
+
+    // proves the hooks are linked in and see the scope, otherwise every
+    // run would pass without checking anything
+    inline bool selfTest()
+    {
+        {
+            const dsp::RealtimeScope realtime;
+            void* volatile ptr = std::malloc(16);
+            std::free(ptr);
+        }
+        const auto trapped = getNumViolations() == 2;
+        resetViolations();
+        return trapped;
+    }
+
+    inline int run(bool abortOnViolation)
+    {
+        std::cerr << "self test: ";
+        if (!selfTest()) {
+            std::cerr << "the hooks didn't trap a malloc inside processBlock\n";
+            return 1;
+        }
+        std::cerr << "ok\n";
+        setAbortOnViolation(abortOnViolation);
+
+        auto failed = 0;
+        for (const auto& config : getConfigs())
+            for (auto numChannels : { 1, 2, 8 })
+                for (auto isDouble : { false, true }) {
+                    if (isDouble)
+                        run<double>(config, numChannels);
+                    else
+                        run<float>(config, numChannels);
+                    const auto n = getNumViolations();
+                    resetViolations();
+                    std::cerr << config.name << ", " << numChannels << " ch, " << (isDouble ? "double" : "float")
+                        << ": " << (n == 0 ? juce::String("ok") : juce::String(n) + " violations") << "\n";
+                    failed += n != 0;
+                }
+        return failed == 0 ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // the processor's parameters expect a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    auto abortOnViolation = false;
+    for (auto i = 1; i < argc; ++i) {
+        const juce::String arg(argv[i]);
+        if (arg == "--abort")
+            abortOnViolation = true;
+        else {
+            std::cout <<
+                "usage: susquash-rtcheck [options]\n"
+                "  --abort  stop at the first violation, for a debugger\n";
+            return arg == "-h" || arg == "--help" ? 0 : 1;
+        }
+    }
+    return rtcheck::run(abortOnViolation);
+}
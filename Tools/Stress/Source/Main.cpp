@@ -0,0 +1,425 @@
+#include <JuceHeader.h>
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <thread>
+#include "../../../Source/PluginProcessor.h"
+
+// many SusquashAudioProcessors in a juce::AudioProcessorGraph, the way a
+// big session has them, driven by a simulated audio device. the device
+// thread automates parameters before every block like a host, while the
+// message thread opens, paints and closes editors. prints json with the
+// distribution of callback times, the deadline misses and the memory an
+// instance costs
+
+namespace stress
+{
+    enum class Topology { Series, Parallel, Tracks };
+
+    struct Settings
+    {
+        Topology topology = Topology::Tracks;
+        int numInstances = 200;
+        // per track, for Topology::Tracks
+        int numInserts = 4;
+        double sampleRate = 48000.;
+        int blockSize = 256;
+        double seconds = 10.;
+        // parameter changes per block, across random instances
+        int numAutomated = 8;
+        // open at once at most, 0 leaves the editors closed
+        int maxEditors = 8;
+        int editorIntervalMs = 50;
+        // false runs the blocks back to back instead of at the device's pace
+        bool paced = true;
+        juce::File output;
+    };
+
+    inline juce::String toString(Topology t)
+    {
+        switch (t) {
+        case Topology::Series: return "series";
+        case Topology::Parallel: return "parallel";
+        default: return "tracks";
+        }
+    }
+
+    inline void printUsage()
+    {
+        std::cout <<
+            "usage: susquash-stress [options]\n"
+            "  -n, --instances <n>   instances in the graph, default 200\n"
+            "  --topology <t>        series, parallel or tracks, default tracks\n"
+            "  --inserts <n>         instances in series per track, default 4\n"
+            "  --rate <hz>           default 48000\n"
+            "  --block <n>           samples per callback, default 256\n"
+            "  --seconds <s>         audio to run, default 10\n"
+            "  --automate <n>        parameter changes per block, default 8\n"
+            "  --editors <n>         editors open at once at most, default 8\n"
+            "  --unpaced             run the callbacks back to back\n"
+            "  -o, --output <file>   write the json there instead of stdout\n";
+    }
+
+    inline juce::String parseArgs(const juce::StringArray& args, Settings& settings)
+    {
+        for (auto i = 0; i < args.size(); ++i) {
+            const auto& arg = args[i];
+            const auto hasValue = i + 1 < args.size();
+            if ((arg == "-n" || arg == "--instances") && hasValue)
+                settings.numInstances = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--topology" && hasValue) {
+                const auto t = args[++i];
+                if (t == "series")
+                    settings.topology = Topology::Series;
+                else if (t == "parallel")
+                    settings.topology = Topology::Parallel;
+                else if (t == "tracks")
+                    settings.topology = Topology::Tracks;
+                else
+                    return "unknown topology " + t;
+            }
+            else if (arg == "--inserts" && hasValue)
+                settings.numInserts = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--rate" && hasValue)
+                settings.sampleRate = juce::jmax(8000., args[++i].getDoubleValue());
+            else if (arg == "--block" && hasValue)
+                settings.blockSize = juce::jmax(1, args[++i].getIntValue());
+            else if (arg == "--seconds" && hasValue)
+                settings.seconds = juce::jmax(.01, args[++i].getDoubleValue());
+            else if (arg == "--automate" && hasValue)
+                settings.numAutomated = juce::jmax(0, args[++i].getIntValue());
+            else if (arg == "--editors" && hasValue)
+                settings.maxEditors = juce::jmax(0, args[++i].getIntValue());
+            else if (arg == "--unpaced")
+                settings.paced = false;
+            else if ((arg == "-o" || arg == "--output") && hasValue)
+                settings.output = juce::File::getCurrentWorkingDirectory().getChildFile(args[++i]);
+            else
+                return "unknown option " + arg;
+        }
+        return {};
+    }
+
+    // resident memory of the whole process, -1 where there's no /proc
+    inline juce::int64 getResidentBytes()
+    {
+       #if JUCE_LINUX
+        const juce::File statm("/proc/self/statm");
+        if (!statm.existsAsFile())
+            return -1;
+        const auto pages = juce::StringArray::fromTokens(statm.loadFileAsString(), true);
+        return pages.size() < 2 ? -1 : pages[1].getLargeIntValue() * static_cast<juce::int64>(sysconf(_SC_PAGESIZE));
+       #else
+        return -1;
+       #endif
+    }
+
+    struct Session
+    {
+        using Node = juce::AudioProcessorGraph::Node;
+        using IO = juce::AudioProcessorGraph::AudioGraphIOProcessor;
+        static constexpr int NumChannels = 2;
+
+        Session(const Settings& _settings) :
+            settings(_settings),
+            graph(),
+            instances(),
+            nodes()
+        {
+            const auto input = graph.addNode(std::make_unique<IO>(IO::audioInputNode));
+            const auto output = graph.addNode(std::make_unique<IO>(IO::audioOutputNode));
+            for (auto i = 0; i < settings.numInstances; ++i) {
+                auto processor = std::make_unique<SusquashAudioProcessor>();
+                instances.push_back(processor.get());
+                nodes.push_back(graph.addNode(std::move(processor)));
+            }
+
+            // series is one chain, parallel a chain per instance, tracks
+            // chains of numInserts. parallel chains get summed at the output
+            const auto chainLength = settings.topology == Topology::Series ? settings.numInstances
+                : settings.topology == Topology::Parallel ? 1
+                : settings.numInserts;
+            for (auto i = 0; i < settings.numInstances; ++i) {
+                const auto first = i % chainLength == 0;
+                const auto last = i % chainLength == chainLength - 1 || i == settings.numInstances - 1;
+                connect(first ? input : nodes[i - 1], nodes[i]);
+                if (last)
+                    connect(nodes[i], output);
+            }
+
+            graph.setPlayConfigDetails(NumChannels, NumChannels, settings.sampleRate, settings.blockSize);
+            graph.prepareToPlay(settings.sampleRate, settings.blockSize);
+        }
+
+        ~Session()
+        {
+            graph.releaseResources();
+        }
+
+        int getNumTracks() const noexcept
+        {
+            return settings.topology == Topology::Series ? 1
+                : settings.topology == Topology::Parallel ? settings.numInstances
+                : (settings.numInstances + settings.numInserts - 1) / settings.numInserts;
+        }
+
+        const Settings& settings;
+        juce::AudioProcessorGraph graph;
+        std::vector<SusquashAudioProcessor*> instances;
+        std::vector<Node::Ptr> nodes;
+
+    protected:
+        void connect(const Node::Ptr& src, const Node::Ptr& dest)
+        {
+            for (auto ch = 0; ch < NumChannels; ++ch)
+                graph.addConnection({ { src->nodeID, ch }, { dest->nodeID, ch } });
+        }
+    };
+
+    // the audio device. every callback fills the input with noise, lets a
+    // few parameters move and renders the graph, then waits for the next
+    // period unless it's unpaced. the times are measured around the
+    // graph's processBlock, the automation included
+    struct Device :
+        public juce::Thread
+    {
+        Device(Session& _session) :
+            juce::Thread("susquash-stress audio"),
+            session(_session),
+            numBlocks(juce::jmax(1, static_cast<int>(session.settings.seconds * session.settings.sampleRate / session.settings.blockSize))),
+            times(),
+            numLate(0)
+        {
+            // the host's automation, only parameters that don't change the latency
+            for (auto i = 0; i < param::NumIDs; ++i) {
+                const auto id = static_cast<param::ID>(i);
+                if (id != param::ID::AntiAlias && id != param::ID::Oversampling
+                    && id != param::ID::OversamplingOffline && id != param::ID::OversamplingFilter)
+                    automated.push_back(param::getID(id));
+            }
+            times.reserve(static_cast<size_t>(numBlocks));
+        }
+
+        ~Device() override
+        {
+            stopThread(-1);
+        }
+
+        void run() override
+        {
+            const auto& settings = session.settings;
+            juce::AudioBuffer<float> buffer(Session::NumChannels, settings.blockSize);
+            juce::MidiBuffer midi;
+            juce::Random rand(1);
+            const auto period = std::chrono::duration<double>(settings.blockSize / settings.sampleRate);
+            const auto clock = std::chrono::steady_clock::now;
+            auto deadline = clock() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+
+            for (auto b = 0; b < numBlocks && !threadShouldExit(); ++b) {
+                for (auto ch = 0; ch < Session::NumChannels; ++ch) {
+                    auto samples = buffer.getWritePointer(ch);
+                    for (auto s = 0; s < settings.blockSize; ++s)
+                        samples[s] = (rand.nextFloat() * 2.f - 1.f) * .25f;
+                }
+
+                const auto start = juce::Time::getHighResolutionTicks();
+                for (auto a = 0; a < settings.numAutomated; ++a) {
+                    auto& processor = *session.instances[static_cast<size_t>(rand.nextInt(static_cast<int>(session.instances.size())))];
+                    auto param = processor.apvts.getParameter(automated[static_cast<size_t>(rand.nextInt(static_cast<int>(automated.size())))]);
+                    param->setValueNotifyingHost(rand.nextFloat());
+                }
+                session.graph.processBlock(buffer, midi);
+                times.push_back(juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start));
+
+                if (!settings.paced)
+                    continue;
+                // a callback that ends after the next one should've started is late,
+                // the next one then starts right away like a device catching up
+                const auto now = clock();
+                if (now > deadline) {
+                    ++numLate;
+                    deadline = now;
+                }
+                else
+                    std::this_thread::sleep_until(deadline);
+                deadline += std::chrono::duration_cast<std::chrono::steady_clock::duration>(period);
+            }
+        }
+
+        Session& session;
+        const int numBlocks;
+        std::vector<double> times;
+        int numLate;
+
+    protected:
+        std::vector<juce::String> automated;
+    };
+
+    // opens an editor on a random instance every interval, or closes one,
+    // keeping at most maxEditors open. every one gets painted into an
+    // image once, there's no window to show it in
+    struct Editors
+    {
+        Editors(Session& _session) :
+            session(_session),
+            open(),
+            rand(2),
+            numOpened(0)
+        {}
+
+        ~Editors()
+        {
+            closeAll();
+        }
+
+        void step()
+        {
+            const auto& settings = session.settings;
+            if (settings.maxEditors == 0)
+                return;
+            const auto close = static_cast<int>(open.size()) == settings.maxEditors
+                || (!open.empty() && rand.nextBool());
+            if (close) {
+                const auto i = static_cast<size_t>(rand.nextInt(static_cast<int>(open.size())));
+                open.erase(open.begin() + static_cast<std::ptrdiff_t>(i));
+                return;
+            }
+            auto& processor = *session.instances[static_cast<size_t>(rand.nextInt(static_cast<int>(session.instances.size())))];
+            if (processor.getActiveEditor() != nullptr)
+                return;
+            std::unique_ptr<juce::AudioProcessorEditor> editor(processor.createEditorIfNeeded());
+            juce::Image img(juce::Image::ARGB, juce::jmax(1, editor->getWidth()), juce::jmax(1, editor->getHeight()), true);
+            juce::Graphics g(img);
+            editor->paintEntireComponent(g, true);
+            open.push_back(std::move(editor));
+            ++numOpened;
+        }
+
+        void closeAll()
+        {
+            open.clear();
+        }
+
+        Session& session;
+        std::vector<std::unique_ptr<juce::AudioProcessorEditor>> open;
+        juce::Random rand;
+        int numOpened;
+    };
+
+    inline double getPercentile(const std::vector<double>& sorted, double p)
+    {
+        const auto i = static_cast<size_t>(std::round(p * static_cast<double>(sorted.size() - 1)));
+        return sorted[i];
+    }
+
+    inline juce::var toJSON(const Settings& settings, const Session& session, const Device& device,
+        int numEditorsOpened, juce::int64 residentBefore, juce::int64 residentAfter)
+    {
+        const auto budget = settings.blockSize / settings.sampleRate;
+        auto times = device.times;
+        std::sort(times.begin(), times.end());
+        const auto numMissed = std::count_if(times.begin(), times.end(), [budget](double t) { return t > budget; });
+
+        // in microseconds and in real time budgets
+        juce::DynamicObject::Ptr callback = new juce::DynamicObject();
+        callback->setProperty("budgetUs", budget * 1e6);
+        callback->setProperty("numCallbacks", static_cast<int>(times.size()));
+        if (!times.empty()) {
+            const auto mean = std::accumulate(times.begin(), times.end(), 0.) / static_cast<double>(times.size());
+            for (const auto& p : { std::make_pair("mean", mean),
+                std::make_pair("p50", getPercentile(times, .5)),
+                std::make_pair("p90", getPercentile(times, .9)),
+                std::make_pair("p99", getPercentile(times, .99)),
+                std::make_pair("p999", getPercentile(times, .999)),
+                std::make_pair("max", times.back()) }) {
+                callback->setProperty(juce::String(p.first) + "Us", p.second * 1e6);
+                callback->setProperty(juce::String(p.first) + "Load", p.second / budget);
+            }
+        }
+        // over budget, and with pacing, ending after the next callback was due
+        callback->setProperty("deadlineMisses", static_cast<int>(numMissed));
+        callback->setProperty("lateCallbacks", device.numLate);
+
+        // the resident growth from building and preparing the graph, and
+        // what the processors' arenas took of it
+        juce::int64 arenaBytes = 0;
+        for (auto processor : session.instances)
+            arenaBytes += static_cast<juce::int64>(processor->arena.getNumBytes());
+        const auto n = static_cast<double>(session.instances.size());
+        juce::DynamicObject::Ptr memory = new juce::DynamicObject();
+        if (residentBefore >= 0 && residentAfter >= 0)
+            memory->setProperty("bytesPerInstance", static_cast<double>(residentAfter - residentBefore) / n);
+        memory->setProperty("arenaBytesPerInstance", static_cast<double>(arenaBytes) / n);
+        memory->setProperty("residentBytes", residentAfter);
+
+        juce::DynamicObject::Ptr root = new juce::DynamicObject();
+        root->setProperty("topology", toString(settings.topology));
+        root->setProperty("numInstances", settings.numInstances);
+        root->setProperty("numTracks", session.getNumTracks());
+        root->setProperty("sampleRate", settings.sampleRate);
+        root->setProperty("blockSize", settings.blockSize);
+        root->setProperty("paced", settings.paced);
+        root->setProperty("isa", dsp::toString(dsp::getISA()));
+        root->setProperty("cpu", juce::SystemStats::getCpuModel());
+        root->setProperty("numCpus", juce::SystemStats::getNumCpus());
+        root->setProperty("editorsOpened", numEditorsOpened);
+        root->setProperty("idleInstances", SusquashAudioProcessor::getNumIdleInstances());
+        root->setProperty("callback", juce::var(callback.get()));
+        root->setProperty("memory", juce::var(memory.get()));
+        return juce::var(root.get());
+    }
+
+    inline int run(const Settings& settings)
+    {
+        const auto residentBefore = getResidentBytes();
+        Session session(settings);
+        const auto residentAfter = getResidentBytes();
+        std::cerr << settings.numInstances << " instances, " << toString(settings.topology) << "\n";
+
+        int numEditorsOpened;
+        juce::var json;
+        {
+            Editors editors(session);
+            Device device(session);
+            // default priority, the os schedules it like any other thread
+            device.startThread();
+            while (device.isThreadRunning()) {
+                editors.step();
+                juce::MessageManager::getInstance()->runDispatchLoopUntil(settings.editorIntervalMs);
+            }
+            editors.closeAll();
+            numEditorsOpened = editors.numOpened;
+            json = toJSON(settings, session, device, numEditorsOpened, residentBefore, residentAfter);
+        }
+
+        const auto text = juce::JSON::toString(json);
+        if (settings.output == juce::File()) {
+            std::cout << text << "\n";
+            return 0;
+        }
+        return settings.output.replaceWithText(text) ? 0 : 1;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    // the parameters and editors expect a message manager, this thread runs it
+    juce::ScopedJuceInitialiser_GUI juceInit;
+
+    juce::StringArray args;
+    for (auto i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+    if (args.contains("-h") || args.contains("--help")) {
+        stress::printUsage();
+        return 0;
+    }
+
+    stress::Settings settings;
+    const auto error = stress::parseArgs(args, settings);
+    if (error.isNotEmpty()) {
+        std::cerr << error << "\n";
+        stress::printUsage();
+        return 1;
+    }
+    return stress::run(settings);
+}